@@ -0,0 +1,50 @@
+#include "alloc_count.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "imgui.h"
+
+static std::atomic<std::uint64_t> allocations{0};
+
+std::uint64_t heapAllocations() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+void countImGuiAllocations() {
+  ImGui::SetAllocatorFunctions(
+      [](std::size_t size, void *) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(size);
+      },
+      [](void *ptr, void *) { std::free(ptr); });
+}
+
+// the array and nothrow forms end up in these
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void *operator new(std::size_t size, std::align_val_t align) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  const std::size_t alignment = static_cast<std::size_t>(align);
+  // aligned_alloc wants a multiple of the alignment
+  const std::size_t rounded =
+      std::max((size + alignment - 1) / alignment, std::size_t{1}) * alignment;
+  if (void *ptr = std::aligned_alloc(alignment, rounded)) {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Heap allocations made so far through global operator new (alloc_count.cpp
+// replaces it, link it into executables only) and, once
+// countImGuiAllocations() ran, through ImGui. Any thread.
+std::uint64_t heapAllocations();
+
+// Routes ImGui's allocations through the counter, call before
+// ImGui::CreateContext()
+void countImGuiAllocations();
@@ -0,0 +1,266 @@
+#include "dashboard.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+#include "dial_mesh.hpp"
+#include "gauge.hpp"
+#include "render_state.hpp"
+
+static const char *vert = R"GLSL(#version 410 core
+layout(location=0) in vec2 position;
+layout(location=1) in vec3 color;
+layout(location=2) in vec4 placement; // xy: center, z: half size, w: angle
+layout(location=3) in float sweep;    // degrees between the end stops
+
+uniform vec2 scale; // pixels to NDC
+uniform bool needle;
+// the dial mesh is marked over dial_sweep degrees, inside markings_radius
+uniform float dial_sweep;
+uniform float markings_radius;
+// map the values to angles here rather than take placement.w
+uniform bool gpu_mapping;
+uniform samplerBuffer values; // raw value of each gauge
+uniform samplerBuffer ranges; // x: min, y: max
+
+out vec3 Color;
+
+void main()
+{
+  float angle = 0.0;
+  if (needle) {
+    angle = placement.w;
+    if (gpu_mapping) {
+      vec2 range = texelFetch(ranges, gl_InstanceID).xy;
+      float value =
+          clamp(texelFetch(values, gl_InstanceID).r, range.x, range.y);
+      angle =
+          radians(((value - range.x) / (range.y - range.x) - 0.5) * sweep);
+    }
+  }
+  // spread the notches and bands over this gauge's sweep, the rim stays
+  vec2 p = position;
+  float r = length(p);
+  if (!needle && r <= markings_radius) {
+    float theta = atan(p.x, p.y) * sweep / dial_sweep;
+    p = r * vec2(sin(theta), cos(theta));
+  }
+  // clockwise from straight up, as gauge_renderer rotates its needle
+  float c = cos(angle);
+  float s = sin(angle);
+  p = vec2(c * p.x + s * p.y, c * p.y - s * p.x);
+  gl_Position = vec4((placement.xy + p * placement.z) * scale - 1.0, 0.0, 1.0);
+  Color = color;
+}
+)GLSL";
+
+static const char *frag = R"GLSL(#version 410 core
+in vec3 Color;
+out vec4 outColor;
+
+void main()
+{
+  outColor = vec4(Color, 1.0);
+}
+)GLSL";
+
+static constexpr GLint VALUES_UNIT = 1, RANGES_UNIT = 2;
+
+// Adds the per gauge attributes to the VAO genVao() left bound
+void dashboard::addInstanceAttributes() {
+  render_state::current().bind_array_buffer(instance_vbo);
+  glEnableVertexAttribArray(2);
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(instance),
+                        (void *)offsetof(instance, placement));
+  glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(instance),
+                        (void *)offsetof(instance, sweep));
+  glVertexAttribDivisor(2, 1);
+  glVertexAttribDivisor(3, 1);
+}
+
+void dashboard::allocate() {
+  program = compileProgram(vert, frag);
+  u_scale = program.location("scale");
+  u_needle = program.location("needle");
+  u_gpu_mapping = program.location("gpu_mapping");
+  program.setUniform("values", VALUES_UNIT);
+  program.setUniform("ranges", RANGES_UNIT);
+  program.setUniform("dial_sweep", NEEDLE_RANGE);
+  // past the longest notch, short of the rim (snorm16 rounding aside)
+  program.setUniform("markings_radius",
+                     DIAMETER * (NOTCH_MAX + (1.0f - NOTCH_MAX) / 2.0f));
+
+  render_state &state = render_state::current();
+  glGenBuffers(1, &instance_vbo);
+  const packed_mesh needle = packMesh(genNeedle());
+  mesh_base = genVao(dial_mesh::INDEXED.vertices, dial_mesh::INDEXED.indices);
+  addInstanceAttributes();
+  mesh_needle = genVao(needle.vertices, needle.indices);
+  addInstanceAttributes();
+  state.bind_array_buffer(0);
+  state.bind_vertex_array(0);
+  base_count = dial_mesh::INDEXED.indices.size();
+  needle_count = needle.indices.size();
+
+  // the buffer a texture buffer reads from keeps its name when it is
+  // orphaned, attaching it once is enough
+  glGenBuffers(1, &values_buffer);
+  glGenBuffers(1, &ranges_buffer);
+  glGenTextures(1, &values_texture);
+  glGenTextures(1, &ranges_texture);
+  glBindBuffer(GL_TEXTURE_BUFFER, values_buffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, ranges_buffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_BUFFER, values_texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, values_buffer);
+  glBindTexture(GL_TEXTURE_BUFFER, ranges_texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, ranges_buffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+  instances.clear();
+  ranges.clear();
+  gauge_count = 0;
+  window_size = {0, 0};
+  frame_stats = {};
+}
+
+void dashboard::destroy() {
+  render_state &state = render_state::current();
+  deleteVao(mesh_base);
+  deleteVao(mesh_needle);
+  state.delete_buffer(instance_vbo);
+  state.delete_buffer(values_buffer);
+  state.delete_buffer(ranges_buffer);
+  glDeleteTextures(1, &values_texture);
+  glDeleteTextures(1, &ranges_texture);
+  program.delete_();
+}
+
+void dashboard::set_gauges(std::span<const gauge> gauges) {
+  instances.resize(gauges.size());
+  ranges.resize(gauges.size());
+  for (std::size_t i = 0; i < gauges.size(); i++) {
+    gauge const &g = gauges[i];
+    assert(g.min < g.max && g.sweep > 0 && g.sweep <= 360);
+    instances[i].placement = {g.center, g.size / 2.0f, 0.0f};
+    instances[i].sweep = g.sweep;
+    ranges[i] = {g.min, g.max};
+  }
+
+  render_state::current().bind_array_buffer(instance_vbo);
+  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(instance),
+               instances.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, ranges_buffer);
+  glBufferData(GL_TEXTURE_BUFFER, ranges.size() * sizeof(glm::vec2),
+               ranges.data(), GL_STATIC_DRAW);
+  gauge_count = gauges.size();
+}
+
+void dashboard::draw(std::span<const float> values, int width, int height) {
+  assert(values.size() == gauge_count);
+  const std::size_t count = std::min(values.size(), gauge_count);
+  if (count == 0) {
+    return;
+  }
+
+  // one float per gauge is all a frame uploads
+  glBindBuffer(GL_TEXTURE_BUFFER, values_buffer);
+  glBufferData(GL_TEXTURE_BUFFER, count * sizeof(float), values.data(),
+               GL_STREAM_DRAW);
+  drawInstances(static_cast<GLsizei>(count), true, width, height);
+}
+
+void dashboard::draw(std::span<const gauge> gauges, int width, int height) {
+  if (gauges.empty()) {
+    return;
+  }
+
+  // only grows, a steady gauge count never reallocates
+  instances.resize(gauges.size());
+  for (std::size_t i = 0; i < gauges.size(); i++) {
+    gauge const &g = gauges[i];
+    assert(g.min < g.max && g.sweep > 0 && g.sweep <= 360);
+    const float value = std::clamp(g.value, g.min, g.max);
+    const float angle =
+        map<float>(value, g.min, g.max, -g.sweep / 2.0f, g.sweep / 2.0f);
+    instances[i].placement = {g.center, g.size / 2.0f, glm::radians(angle)};
+    instances[i].sweep = g.sweep;
+  }
+
+  // orphan the previous contents so the driver never stalls on them
+  render_state::current().bind_array_buffer(instance_vbo);
+  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(instance),
+               instances.data(), GL_STREAM_DRAW);
+  gauge_count = 0;
+  drawInstances(static_cast<GLsizei>(gauges.size()), false, width, height);
+}
+
+void dashboard::drawInstances(GLsizei count, bool gpu_mapping, int width,
+                              int height) {
+  if (window_size != glm::ivec2{width, height}) {
+    program.setUniform(u_scale, glm::vec2{2.0f / width, 2.0f / height});
+    window_size = {width, height};
+  }
+  if (gpu_mapping) {
+    glActiveTexture(GL_TEXTURE0 + VALUES_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, values_texture);
+    glActiveTexture(GL_TEXTURE0 + RANGES_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, ranges_texture);
+    // render_state tracks the 2D texture of unit 0
+    glActiveTexture(GL_TEXTURE0);
+  }
+
+  render_state &state = render_state::current();
+  state.set_blend(false);
+  program.use();
+  program.setUniform(u_gpu_mapping, gpu_mapping);
+  program.setUniform(u_needle, false);
+  state.bind_vertex_array(mesh_base.vao);
+  glDrawElementsInstanced(GL_TRIANGLES, base_count, GL_UNSIGNED_SHORT, nullptr,
+                          count);
+  program.setUniform(u_needle, true);
+  state.bind_vertex_array(mesh_needle.vao);
+  glDrawElementsInstanced(GL_TRIANGLES, needle_count, GL_UNSIGNED_SHORT,
+                          nullptr, count);
+  frame_stats.draw_calls += 2;
+  frame_stats.gauges += count;
+}
+
+dashboard::stats dashboard::reset_stats() {
+  const stats ret = frame_stats;
+  frame_stats = {};
+  return ret;
+}
+
+void layOutGrid(std::span<dashboard::gauge> gauges, int width, int height) {
+  const int count = static_cast<int>(gauges.size());
+  if (count == 0) {
+    return;
+  }
+
+  // the column count that gives the biggest cells
+  int columns = 1;
+  float cell = 0;
+  for (int c = 1; c <= count; c++) {
+    const int rows = (count + c - 1) / c;
+    const float size = std::min(float(width) / c, float(height) / rows);
+    if (size > cell) {
+      cell = size;
+      columns = c;
+    }
+  }
+
+  const int rows = (count + columns - 1) / columns;
+  // center the grid in the window
+  const glm::vec2 origin{(width - cell * columns) / 2.0f,
+                         (height + cell * rows) / 2.0f};
+  for (int i = 0; i < count; i++) {
+    const int column = i % columns, row = i / columns;
+    gauges[i].center = origin + glm::vec2{(column + 0.5f) * cell,
+                                          -(row + 0.5f) * cell};
+    gauges[i].size = cell;
+  }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "gauge.hpp"
+#include "gauge_config.hpp"
+#include "shader.hpp"
+
+// A wall of gauges, i.e. one per engine or pump. Every dial is drawn with a
+// single instanced draw call and every needle with a second one, however
+// many gauges there are. Labels are left to text_renderer.
+//
+// Placement and range of each gauge are uploaded once by set_gauges(), after
+// that a frame uploads nothing but the raw values into a texture buffer and
+// the vertex shader maps them to needle angles.
+//
+// Every dial shares the gauge_renderer mesh, its notches and color bands are
+// spread over each gauge's sweep so that they mark the same fractions of any
+// range: the last notch is `max`, the red band the top fifth.
+class dashboard {
+public:
+  struct gauge {
+    glm::vec2 center{0, 0}; // in pixels, origin at the bottom left
+    float size{0};          // side of the square the dial fills, in pixels
+    float value{RPM_MIN};
+    // swept by the needle, values outside it pin the needle to an end stop
+    float min{RPM_MIN}, max{RPM_MAX};
+    // degrees between the end stops, up to 360
+    float sweep{NEEDLE_RANGE};
+  };
+
+  struct stats {
+    std::size_t draw_calls{0};
+    std::size_t gauges{0};
+  };
+
+  void allocate();
+  void destroy();
+
+  // Uploads where the gauges go and their ranges, their values are ignored.
+  // Up to GL_MAX_TEXTURE_BUFFER_SIZE gauges, at least 65536.
+  void set_gauges(std::span<const gauge> gauges);
+  // Draws the gauges passed to set_gauges() showing `values`, one per gauge
+  // in the same order
+  void draw(std::span<const float> values, int width, int height);
+  // Maps every value to a needle angle on the CPU and uploads the whole
+  // gauge again, the baseline the texture buffer path is benchmarked against.
+  // Forgets the gauges passed to set_gauges().
+  void draw(std::span<const gauge> gauges, int width, int height);
+  // counters accumulated since the previous call
+  stats reset_stats();
+
+private:
+  // one per gauge, attributes 2 and 3 of both VAOs
+  struct instance {
+    glm::vec4 placement; // xy: center, z: half the size, w: needle angle
+    float sweep;
+  };
+
+  Program program;
+  GLint u_scale, u_needle, u_gpu_mapping;
+  vao_vbo mesh_base, mesh_needle;
+  GLuint instance_vbo;
+  // texture buffers, bound to texture units 1 and 2 while drawing
+  GLuint values_buffer, values_texture;
+  GLuint ranges_buffer, ranges_texture;
+  GLsizei base_count, needle_count;
+  std::vector<instance> instances;
+  std::vector<glm::vec2> ranges; // x: min, y: max
+  std::size_t gauge_count{0}; // passed to set_gauges()
+  glm::ivec2 window_size{0, 0};
+  stats frame_stats;
+
+  void addInstanceAttributes();
+  void drawInstances(GLsizei count, bool gpu_mapping, int width, int height);
+};
+
+// Sizes and places the gauges on the most square grid that holds them all
+// in a width x height window, row by row from the top left
+void layOutGrid(std::span<dashboard::gauge> gauges, int width, int height);
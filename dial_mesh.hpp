@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "gauge_config.hpp"
+#include "packed_mesh.hpp"
+
+// The dial genCompleteBase() builds, generated entirely at compile time so
+// startup only uploads a static blob. Same vertex order and layout as
+// datapack, so both go through the same VAO setup.
+namespace dial_mesh {
+namespace impl {
+inline constexpr double PI = 3.14159265358979323846;
+
+// <cmath> is not constexpr yet, these only need to be good to float precision
+constexpr double sin(double x) {
+  // reduce to [-pi, pi], then to [-pi/2, pi/2] where the series converges fast
+  while (x > PI) {
+    x -= 2 * PI;
+  }
+  while (x < -PI) {
+    x += 2 * PI;
+  }
+  if (x > PI / 2) {
+    x = PI - x;
+  } else if (x < -PI / 2) {
+    x = -PI - x;
+  }
+  double term = x, sum = x;
+  for (int n = 1; n < 12; n++) {
+    term *= -x * x / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+constexpr double cos(double x) { return sin(x + PI / 2); }
+constexpr float radians(float degrees) {
+  return static_cast<float>(degrees * PI / 180.0);
+}
+constexpr float abs(float x) { return x < 0 ? -x : x; }
+constexpr float clamp01(float x) { return x < 0 ? 0 : (x > 1 ? 1 : x); }
+} // namespace impl
+
+struct vertex {
+  float x, y, layer; // matches datapack::pos
+  float r, g, b;     // matches datapack::color
+};
+
+inline constexpr int CIRCLE_DIVISIONS = 64;
+inline constexpr int BANDS = (RPM_MAX - RPM_MIN) / RPM_STEP;
+inline constexpr int NOTCH_COUNT = (RPM_MAX - RPM_MIN) / RPM_STEP + 1;
+inline constexpr std::size_t SIZE =
+    CIRCLE_DIVISIONS * 3 + BANDS * 6 + NOTCH_COUNT * 6;
+
+// constexpr twin of Hue(), H in [0, 360)
+constexpr vertex color(float H) {
+  H = H / 360.0f;
+  return {0,
+          0,
+          0,
+          impl::clamp01(impl::abs(H * 6 - 3) - 1),
+          impl::clamp01(2 - impl::abs(H * 6 - 2)),
+          impl::clamp01(2 - impl::abs(H * 6 - 4))};
+}
+
+constexpr std::array<vertex, SIZE> generate() {
+  std::array<vertex, SIZE> ret{};
+  std::size_t n = 0;
+  const auto emit = [&](float x, float y, float layer, vertex c) {
+    ret[n++] = {x * DIAMETER, y * DIAMETER, layer, c.r, c.g, c.b};
+  };
+
+  constexpr float min = 90.0f + (NEEDLE_RANGE / 2.0f);
+  constexpr float max = 90.0f - (NEEDLE_RANGE / 2.0f);
+
+  // build circle
+  constexpr vertex grey{0, 0, 0, 0.7f, 0.7f, 0.7f};
+  for (int i = 0; i < CIRCLE_DIVISIONS; i++) {
+    const double o1 =
+        (static_cast<double>(i) / CIRCLE_DIVISIONS) * 2 * impl::PI;
+    const double o2 =
+        (static_cast<double>(i + 1) / CIRCLE_DIVISIONS) * 2 * impl::PI;
+    emit(0, 0, 0, grey);
+    emit(impl::cos(o1), impl::sin(o1), 0, grey);
+    emit(impl::cos(o2), impl::sin(o2), 0, grey);
+  }
+
+  // color bands
+  for (int rpm = RPM_MIN; rpm < RPM_MAX; rpm += RPM_STEP) {
+    const float angle1 = impl::radians(map<float>(rpm, 0, RPM_MAX, min, max));
+    const float angle2 =
+        impl::radians(map<float>(rpm + RPM_STEP, 0, RPM_MAX, min, max));
+    const float c1 = impl::cos(angle1);
+    const float s1 = impl::sin(angle1);
+    const float c2 = impl::cos(angle2);
+    const float s2 = impl::sin(angle2);
+
+    vertex c{};
+    if (rpm < 500 || (rpm >= 2600 && rpm < 2800)) {
+      c = color(60); // yellow
+    } else if (rpm >= 2800) {
+      c = color(0); // red
+    } else {
+      c = color(140); // green
+    }
+
+    emit(c1 * NOTCH_MAX_SMALL, s1 * NOTCH_MAX_SMALL, 1, c);
+    emit(c1 * NOTCH_MIN, s1 * NOTCH_MIN, 1, c);
+    emit(c2 * NOTCH_MIN, s2 * NOTCH_MIN, 1, c);
+
+    emit(c1 * NOTCH_MAX_SMALL, s1 * NOTCH_MAX_SMALL, 1, c);
+    emit(c2 * NOTCH_MAX_SMALL, s2 * NOTCH_MAX_SMALL, 1, c);
+    emit(c2 * NOTCH_MIN, s2 * NOTCH_MIN, 1, c);
+  }
+
+  // notches, two triangles rotated into place
+  constexpr vertex dark{0, 0, 0, 0.2f, 0.2f, 0.2f};
+  for (int rpm = RPM_MIN; rpm <= RPM_MAX; rpm += RPM_STEP) {
+    const float angle =
+        impl::radians(map<float>(rpm, RPM_MIN, RPM_MAX, min, max));
+    const float c = impl::cos(angle);
+    const float s = impl::sin(angle);
+    const float outer =
+        rpm % (RPM_STEP * 5) == 0 ? NOTCH_MAX : NOTCH_MAX_SMALL;
+
+    const float quad[6][2] = {
+        {NOTCH_MIN, +NOTCH_WIDTH / 2}, {NOTCH_MIN, -NOTCH_WIDTH / 2},
+        {outer, +NOTCH_WIDTH / 2},     {NOTCH_MIN, -NOTCH_WIDTH / 2},
+        {outer, +NOTCH_WIDTH / 2},     {outer, -NOTCH_WIDTH / 2},
+    };
+    for (auto const &p : quad) {
+      emit(c * p[0] - s * p[1], s * p[0] + c * p[1], 3, dark);
+    }
+  }
+
+  return ret;
+}
+
+inline constexpr std::array<vertex, SIZE> VERTICES = generate();
+
+// The same dial packed and deduplicated into an indexed mesh, also at compile
+// time; this is what gets uploaded
+constexpr std::array<packed_vertex, SIZE> pack_all() {
+  std::array<packed_vertex, SIZE> ret{};
+  std::transform(VERTICES.begin(), VERTICES.end(), ret.begin(),
+                 [](vertex const &v) {
+                   return packed::pack(v.x, v.y, v.r, v.g, v.b);
+                 });
+  return ret;
+}
+inline constexpr std::array<packed_vertex, SIZE> PACKED = pack_all();
+
+constexpr std::size_t unique_count() {
+  std::array<packed_vertex, SIZE> vertices{};
+  std::array<std::uint16_t, SIZE> indices{};
+  return packed::index_vertices(PACKED, vertices.data(), indices.data());
+}
+inline constexpr std::size_t UNIQUE = unique_count();
+
+struct indexed_mesh {
+  std::array<packed_vertex, UNIQUE> vertices;
+  std::array<std::uint16_t, SIZE> indices;
+};
+
+constexpr indexed_mesh index() {
+  std::array<packed_vertex, SIZE> vertices{};
+  indexed_mesh ret{};
+  packed::index_vertices(PACKED, vertices.data(), ret.indices.data());
+  std::copy_n(vertices.begin(), UNIQUE, ret.vertices.begin());
+  return ret;
+}
+inline constexpr indexed_mesh INDEXED = index();
+
+static_assert(VERTICES[0].x == 0 && VERTICES[0].y == 0,
+              "circle fan starts at the center");
+static_assert(impl::abs(VERTICES[1].x - DIAMETER) < 1e-6f &&
+                  impl::abs(VERTICES[1].y) < 1e-6f,
+              "first rim vertex sits at angle 0");
+} // namespace dial_mesh
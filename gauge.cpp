@@ -0,0 +1,383 @@
+#include "gauge.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <iterator>
+#include <utility>
+
+#include <glm/ext.hpp>
+
+#include "dial_mesh.hpp"
+#include "program_cache.hpp"
+#include "render_state.hpp"
+#include "startup_log.hpp"
+
+void gauge_renderer::allocate(glyph_format text_format,
+                              std::function<void()> on_text_loaded) {
+  std::vector<datapack> needle = genNeedle();
+
+  program = genShapeRenderingProgram();
+  u_view = program.location("view");
+  u_model = program.location("model");
+
+  packed_mesh packed_needle = packMesh(needle);
+  mesh_base = genVao(dial_mesh::INDEXED.vertices, dial_mesh::INDEXED.indices);
+  mesh_needle = genVao(packed_needle.vertices, packed_needle.indices);
+  base_count = dial_mesh::INDEXED.indices.size();
+  needle_count = packed_needle.indices.size();
+  startup_log::stage("dial and needle");
+
+  sdf.allocate();
+  cache.allocate();
+  cached = {};
+  labels_key = {};
+  hours_shown = -1;
+  hours_label.reserve(sizeof(hours_text));
+  startup_log::stage("sdf dial");
+
+  text.allocate(text_format, std::move(on_text_loaded));
+  text_color = gauge_theme{}.text;
+  text.set_color(text_color);
+  startup_log::stage("text renderer");
+}
+
+void gauge_renderer::destroy() {
+  text.destroy();
+  sdf.destroy();
+  cache.destroy();
+  deleteVao(mesh_base);
+  deleteVao(mesh_needle);
+  program.delete_();
+}
+
+float gauge_renderer::needle_angle(float rpm) {
+  return map<float>(rpm, RPM_MIN, RPM_MAX, -NEEDLE_RANGE / 2.0f,
+                    NEEDLE_RANGE / 2.0f);
+}
+
+void gauge_renderer::draw(frame const &f) {
+  const bool labels = text.poll_loaded();
+  text.set_window_size(f.width, f.height);
+  if (f.theme.text != text_color) {
+    text.set_color(f.theme.text);
+    text_color = f.theme.text;
+  }
+
+  glm::mat4 view = glm::identity<glm::mat4>();
+  float scale = 0;
+  if (f.width > f.height) {
+    scale = float(f.height) / float(f.width);
+    view = glm::scale(view, {scale, 1, 1});
+  } else {
+    scale = float(f.width) / float(f.height);
+    view = glm::scale(view, {1, scale, 1});
+  }
+
+  if (f.mode == dial_mode::sdf) {
+    sdf.draw(f.width > f.height ? glm::vec2{scale, 1} : glm::vec2{1, scale},
+             needle_angle(f.rpm));
+    queueNotchLabels(f, view, scale);
+  } else if (!f.cache_static) {
+    drawBase(view);
+    drawNeedle(view, f.rpm);
+    queueNotchLabels(f, view, scale);
+  } else {
+    const static_key key{f.width, f.height, f.notch_text_scale, f.theme,
+                         labels};
+    if (key == cached) {
+      counters.cache_hits++;
+    } else {
+      counters.cache_misses++;
+      glClearColor(f.theme.background.r, f.theme.background.g,
+                   f.theme.background.b, 1.0f);
+      cache.begin(f.width, f.height);
+      drawBase(view);
+      queueNotchLabels(f, view, scale);
+      text.flush();
+      cache.end();
+      cached = key;
+    }
+    // the labels end up under the needle here, they never overlap it
+    cache.blit();
+    drawNeedle(view, f.rpm);
+  }
+
+  queueHoursLabel(f, scale);
+  text.flush();
+}
+
+void gauge_renderer::drawBase(glm::mat4 const &view) {
+  render_state::current().set_blend(false);
+  program.use();
+  program.setUniform(u_view, view);
+  program.setUniform(u_model, glm::identity<glm::mat4>());
+
+  render_state::current().bind_vertex_array(mesh_base.vao);
+  glDrawElements(GL_TRIANGLES, base_count, GL_UNSIGNED_SHORT, nullptr);
+}
+
+void gauge_renderer::drawNeedle(glm::mat4 const &view, float rpm) {
+  render_state::current().set_blend(false);
+  program.use();
+  program.setUniform(u_view, view);
+  glm::mat4 model = glm::rotate(glm::identity<glm::mat4>(),
+                                glm::radians(needle_angle(rpm)),
+                                glm::vec3(0.0f, 0.0f, -1.0f));
+  program.setUniform(u_model, model);
+
+  render_state::current().bind_vertex_array(mesh_needle.vao);
+  glDrawElements(GL_TRIANGLES, needle_count, GL_UNSIGNED_SHORT, nullptr);
+}
+
+void gauge_renderer::queueNotchLabels(frame const &f, glm::mat4 const &view,
+                                      float scale) {
+  const static_key key{f.width, f.height, f.notch_text_scale};
+  const bool moved = key != labels_key;
+  labels_key = key;
+  for (int i = 0; i < NOTCH_LABELS; i++) {
+    if (moved) {
+      constexpr float min = 90.0f + (NEEDLE_RANGE / 2.0f);
+      constexpr float max = 90.0f - (NEEDLE_RANGE / 2.0f);
+      const float angle1 = glm::radians(map<float>(
+          i, 0, static_cast<float>(RPM_MAX) / (RPM_STEP * 5), min, max));
+      glm::vec2 pos{std::cos(angle1), std::sin(angle1)};
+      pos = view * glm::vec4(pos * DIAMETER * NOTCH_MAX, 0, 0);
+      pos = map<glm::vec2>(pos, {-1, -1}, {1, 1}, {0, 0},
+                           {f.width, f.height});
+
+      char label[16];
+      std::snprintf(label, sizeof(label), "%d", i * RPM_STEP * 5 / 100);
+      notch_labels[i].set(label, pos.x, pos.y, f.notch_text_scale * scale);
+    }
+    text.queue(notch_labels[i]);
+    if (!f.batch_text) {
+      text.flush();
+    }
+  }
+}
+
+void gauge_renderer::queueHoursLabel(frame const &f, float scale) {
+  if (f.hours != hours_shown) {
+    std::snprintf(hours_text, sizeof(hours_text), "Hours %0.1f", f.hours);
+    hours_shown = f.hours;
+  }
+  glm::vec2 pos =
+      map<glm::vec2>({0, -0.2}, {-1, -1}, {1, 1}, {0, 0}, {f.width, f.height});
+  hours_label.set(hours_text, pos.x, pos.y, f.notch_text_scale * scale);
+  text.queue(hours_label);
+}
+
+glm::vec3 Hue(float H) {
+  H = map<float>(std::fmod(H, 360.0f), 0, 360, 0, 1);
+  float R = std::abs(H * 6 - 3) - 1;
+  float G = 2 - std::abs(H * 6 - 2);
+  float B = 2 - std::abs(H * 6 - 4);
+  return glm::clamp(glm::vec3(R, G, B));
+}
+
+std::vector<datapack> genCompleteBase() {
+  std::vector<datapack> ret;
+
+  const float min = 90.0f + (NEEDLE_RANGE / 2.0f);
+  const float max = 90.0f - (NEEDLE_RANGE / 2.0f);
+  const int STEPS = RPM_MAX / RPM_STEP;
+
+  const float HUE_RED = 0;
+  const float HUE_YELLOW = 60;
+  const float HUE_GREEN = 140;
+
+  constexpr int CIRCLE_DIVISIONS = 64;
+  // build circle
+  for (int i = 0; i < CIRCLE_DIVISIONS; i++) {
+    float o1 = (static_cast<float>(i) / CIRCLE_DIVISIONS) * (2.0f * M_PI);
+    float o2 = (static_cast<float>(i + 1) / CIRCLE_DIVISIONS) * (2.0f * M_PI);
+    ret.emplace_back(glm::vec3{0, 0, 0}, glm::vec3{0.7, 0.7, 0.7});
+    ret.emplace_back(glm::vec3{std::cos(o1), std::sin(o1), 0},
+                     glm::vec3{0.7, 0.7, 0.7});
+    ret.emplace_back(glm::vec3{std::cos(o2), std::sin(o2), 0},
+                     glm::vec3{0.7, 0.7, 0.7});
+  }
+
+  for (int rpm = RPM_MIN; rpm < RPM_MAX; rpm += RPM_STEP) {
+    const float angle1 = glm::radians(map<float>(rpm, 0, RPM_MAX, min, max));
+    const float angle2 =
+        glm::radians(map<float>(rpm + RPM_STEP, 0, RPM_MAX, min, max));
+    const float c1 = std::cos(angle1);
+    const float s1 = std::sin(angle1);
+    const float c2 = std::cos(angle2);
+    const float s2 = std::sin(angle2);
+
+    glm::vec3 color;
+    if (rpm < 500 || (rpm >= 2600 && rpm < 2800)) {
+      color = Hue(HUE_YELLOW);
+    } else if (rpm >= 2800) {
+      color = Hue(HUE_RED);
+    } else {
+      color = Hue(HUE_GREEN);
+    }
+
+    ret.emplace_back(glm::vec3{c1 * NOTCH_MAX_SMALL, s1 * NOTCH_MAX_SMALL, 1},
+                     color);
+    ret.emplace_back(glm::vec3{c1 * NOTCH_MIN, s1 * NOTCH_MIN, 1}, color);
+    ret.emplace_back(glm::vec3{c2 * NOTCH_MIN, s2 * NOTCH_MIN, 1}, color);
+
+    ret.emplace_back(glm::vec3{c1 * NOTCH_MAX_SMALL, s1 * NOTCH_MAX_SMALL, 1},
+                     color);
+    ret.emplace_back(glm::vec3{c2 * NOTCH_MAX_SMALL, s2 * NOTCH_MAX_SMALL, 1},
+                     color);
+    ret.emplace_back(glm::vec3{c2 * NOTCH_MIN, s2 * NOTCH_MIN, 1}, color);
+  }
+
+  const datapack notch_small[] = {
+      // triangle 1
+      {glm::vec3{NOTCH_MIN, +NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
+      {glm::vec3{NOTCH_MIN, -NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
+      {glm::vec3{NOTCH_MAX_SMALL, +NOTCH_WIDTH / 2, 3},
+       glm::vec3{0.2, 0.2, 0.2}},
+      // triangle 2
+      {glm::vec3{NOTCH_MIN, -NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
+      {glm::vec3{NOTCH_MAX_SMALL, +NOTCH_WIDTH / 2, 3},
+       glm::vec3{0.2, 0.2, 0.2}},
+      {glm::vec3{NOTCH_MAX_SMALL, -NOTCH_WIDTH / 2, 3},
+       glm::vec3{0.2, 0.2, 0.2}},
+  };
+  const datapack notch_large[] = {
+      // triangle 1
+      {glm::vec3{NOTCH_MIN, +NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
+      {glm::vec3{NOTCH_MIN, -NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
+      {glm::vec3{NOTCH_MAX, +NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
+      // triangle 2
+      {glm::vec3{NOTCH_MIN, -NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
+      {glm::vec3{NOTCH_MAX, +NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
+      {glm::vec3{NOTCH_MAX, -NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
+  };
+
+  for (int rpm = RPM_MIN; rpm <= RPM_MAX; rpm += RPM_STEP) {
+    const float i_ = static_cast<float>(rpm) / (NOTCHES - 1);
+    const float angle =
+        glm::radians(map<float>(rpm, RPM_MIN, RPM_MAX, min, max));
+
+    glm::mat4 mat = glm::rotate(glm::identity<glm::mat4>(), angle, {0, 0, 1});
+    const datapack *cbegin, *cend;
+    if (rpm % (RPM_STEP * 5) == 0) {
+      cbegin = std::cbegin(notch_large);
+      cend = std::cend(notch_large);
+    } else {
+      cbegin = std::cbegin(notch_small);
+      cend = std::cend(notch_small);
+    }
+    std::transform(cbegin, cend, std::back_inserter(ret), [&](datapack data) {
+      data.pos = mat * glm::vec4(data.pos, 0);
+      return data;
+    });
+  }
+
+  for (datapack &vert : ret) {
+    vert.pos *= glm::vec3{DIAMETER, DIAMETER, 1.0};
+  }
+
+  return ret;
+}
+
+std::vector<datapack> genNeedle() {
+  std::vector<datapack> ret = {
+      // only four verticies are needed since we are using GL_TRIANGLE_STRIP
+      // base
+      {glm::vec3{-NEEDLE_WIDTH / 2, -NEEDLE_OFFSET, 0}, {0.6, 0.4, 0.4}},
+      {glm::vec3{+NEEDLE_WIDTH / 2, -NEEDLE_OFFSET, 0}, {0.6, 0.4, 0.4}},
+      // edge
+      {glm::vec3{-NEEDLE_WIDTH / 2, NEEDLE_LENGTH - NEEDLE_OFFSET, 0},
+       {0.6, 0.2, 0.2}},
+
+      {glm::vec3{+NEEDLE_WIDTH / 2, -NEEDLE_OFFSET, 0}, {0.6, 0.4, 0.4}},
+      {glm::vec3{-NEEDLE_WIDTH / 2, NEEDLE_LENGTH - NEEDLE_OFFSET, 0},
+       {0.6, 0.2, 0.2}},
+
+      {glm::vec3{+NEEDLE_WIDTH / 2, NEEDLE_LENGTH - NEEDLE_OFFSET, 0},
+       {0.6, 0.2, 0.2}},
+  };
+
+  return ret;
+}
+
+int compileProgram(const char *vert, const char *frag) {
+  return program_cache::current().load(vert, frag);
+}
+
+int genShapeRenderingProgram() {
+  static const char *vert = R"GLSL(#version 410 core
+  layout(location=0) in vec2 position;
+  layout(location=1) in vec3 color;
+  
+  uniform mat4 model;
+  uniform mat4 view;
+  
+  out vec3 Color;
+  
+  void main()
+  {
+    gl_Position = (view * model) * vec4(position, 0.0, 1.0);
+    Color = color;
+  }
+  )GLSL";
+
+  static const char *frag = R"GLSL(#version 410 core
+  in vec3 Color;
+  out vec4 outColor;
+  
+  void main()
+  {
+    outColor = vec4(Color, 1.0);
+  }
+  )GLSL";
+  return compileProgram(vert, frag);
+}
+
+packed_mesh packMesh(std::vector<datapack> const &data) {
+  std::vector<packed_vertex> all;
+  all.reserve(data.size());
+  for (datapack const &vert : data) {
+    all.push_back(packed::pack(vert.pos.x, vert.pos.y, vert.color.r,
+                               vert.color.g, vert.color.b));
+  }
+
+  packed_mesh ret;
+  ret.vertices.resize(all.size());
+  ret.indices.resize(all.size());
+  ret.vertices.resize(
+      packed::index_vertices(all, ret.vertices.data(), ret.indices.data()));
+  return ret;
+}
+
+vao_vbo genVao(std::span<const packed_vertex> vertices,
+               std::span<const std::uint16_t> indices) {
+  render_state &state = render_state::current();
+  GLuint vao;
+  glGenVertexArrays(1, &vao);
+  state.bind_vertex_array(vao);
+  GLuint buffers[2];
+  glGenBuffers(2, buffers);
+  state.bind_array_buffer(buffers[0]);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(),
+               GL_STATIC_DRAW);
+  // element array binding is part of the VAO, no need to track it
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(),
+               GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(0, 2, GL_SHORT, GL_TRUE, sizeof(packed_vertex),
+                        (void *)offsetof(packed_vertex, x));
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(packed_vertex),
+                        (void *)offsetof(packed_vertex, r));
+  return {vao, buffers[0], buffers[1]};
+}
+
+void deleteVao(vao_vbo const &mesh) {
+  render_state &state = render_state::current();
+  state.delete_vertex_array(mesh.vao);
+  state.delete_buffer(mesh.vbo);
+  state.delete_buffer(mesh.ibo);
+}
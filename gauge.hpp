@@ -0,0 +1,127 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "gauge_config.hpp"
+#include "layer_cache.hpp"
+#include "packed_mesh.hpp"
+#include "sdf_gauge.hpp"
+#include "shader.hpp"
+#include "text_renderer.hpp"
+
+struct datapack {
+  glm::vec3 pos;
+  glm::vec3 color;
+};
+
+// A VAO and the vertex and index buffers it reads from
+struct vao_vbo {
+  GLuint vao;
+  GLuint vbo;
+  GLuint ibo;
+};
+
+glm::vec3 Hue(float H);
+std::vector<datapack> genCompleteBase();
+std::vector<datapack> genNeedle();
+int compileProgram(const char *vert, const char *frag);
+int genShapeRenderingProgram();
+// Packs and deduplicates a datapack mesh into the compact indexed format
+packed_mesh packMesh(std::vector<datapack> const &data);
+// Indexed mesh, draw with glDrawElements(GL_TRIANGLES, ..., GL_UNSIGNED_SHORT)
+vao_vbo genVao(std::span<const packed_vertex> vertices,
+               std::span<const std::uint16_t> indices);
+void deleteVao(vao_vbo const &mesh);
+
+// Colors that are baked into the cached static layer, changing any of them
+// re-renders it
+struct gauge_theme {
+  glm::vec3 background{0.2f, 0.2f, 0.2f};
+  glm::vec3 text{0.3f, 0.3f, 0.3f};
+
+  bool operator==(gauge_theme const &) const = default;
+};
+
+// Everything needed to draw one gauge: dial, needle, notch labels and the
+// hours line. Shared by the interactive window and the headless benchmark so
+// both render exactly the same frame.
+class gauge_renderer {
+public:
+  enum class dial_mode {
+    mesh, // tessellated dial and needle meshes
+    sdf,  // one quad, shapes evaluated in the fragment shader (sdf_gauge)
+  };
+
+  struct frame {
+    int width, height;
+    float rpm{0}, hours{0};
+    float notch_text_scale{1.0f};
+    bool batch_text{true};
+    dial_mode mode{dial_mode::mesh};
+    gauge_theme theme{};
+    // draw the dial and notch labels from a cached copy, only re-rendered
+    // when the size, notch_text_scale or theme change or the labels finish
+    // loading (mesh mode only)
+    bool cache_static{true};
+  };
+
+  struct stats {
+    std::size_t cache_hits{0};
+    std::size_t cache_misses{0};
+  };
+
+  // Both are passed on to text_renderer::allocate(), the notch labels are
+  // missing from frames drawn before `on_text_loaded` ran
+  void allocate(glyph_format text_format = glyph_format::coverage,
+                std::function<void()> on_text_loaded = {});
+  void destroy();
+
+  // angle of the needle in degrees for a given rpm, 0 is straight up
+  static float needle_angle(float rpm);
+  void draw(frame const &f);
+  // totals since allocate()
+  stats cache_stats() const { return counters; }
+
+  text_renderer text;
+
+private:
+  // everything the static layer depends on
+  struct static_key {
+    int width{0}, height{0};
+    float notch_text_scale{0};
+    gauge_theme theme{};
+    bool labels{false}; // the glyph atlas had been loaded
+
+    bool operator==(static_key const &) const = default;
+  };
+
+  sdf_gauge sdf;
+  Program program;
+  GLint u_view, u_model;
+  vao_vbo mesh_base, mesh_needle;
+  GLsizei base_count, needle_count;
+  layer_cache cache;
+  static_key cached;
+  glm::vec3 text_color;
+  stats counters;
+
+  // labels are only laid out again when the size or text scale change
+  static constexpr int NOTCH_LABELS = RPM_MAX / (RPM_STEP * 5) + 1;
+  text_layout notch_labels[NOTCH_LABELS];
+  text_layout hours_label;
+  static_key labels_key{};
+  float hours_shown{-1};
+  char hours_text[32]{};
+
+  void drawBase(glm::mat4 const &view);
+  void drawNeedle(glm::mat4 const &view, float rpm);
+  void queueNotchLabels(frame const &f, glm::mat4 const &view, float scale);
+  void queueHoursLabel(frame const &f, float scale);
+};
@@ -0,0 +1,730 @@
+// Micro and macro benchmarks for the gauge, printed as JSON so results can be
+// diffed between versions:
+//
+//   gauge_bench [--filter SUBSTRING] [--min-time SECONDS] > results.json
+//
+// Every benchmark reports ns/op, heap allocations/op and GL calls/op. GL
+// benchmarks render through a headless_context and are skipped when no
+// OpenGL 4.1 context can be created. The "meshes" section lists the bytes each
+// mesh takes as datapack vertices and in the packed indexed format.
+//
+// Some benchmarks check what they run as well (the compile time dial, ring
+// ordering, torn seqlock reads, needle dynamics response, heap allocations in
+// steady state frames) and abort when it is wrong.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "alloc_count.hpp"
+#include "dashboard.hpp"
+#include "dial_mesh.hpp"
+#include "gauge.hpp"
+#include "glyph_atlas.hpp"
+#include "headless.hpp"
+#include "needle_dynamics.hpp"
+#include "program_cache.hpp"
+#include "render_state.hpp"
+#include "seqlock.hpp"
+#include "telemetry.hpp"
+#include "telemetry_log.hpp"
+#include "text_renderer.hpp"
+
+static std::uint64_t gl_calls{0};
+
+namespace {
+// Swaps a glad function pointer for a trampoline that counts calls to it
+template <auto *Slot, typename Fn> struct gl_counter;
+template <auto *Slot, typename R, typename... Args>
+struct gl_counter<Slot, R(GLAD_API_PTR *)(Args...)> {
+  static inline R(GLAD_API_PTR *original)(Args...) = nullptr;
+  static R GLAD_API_PTR call(Args... args) {
+    gl_calls++;
+    return original(args...);
+  }
+  static void install() {
+    if (*Slot && *Slot != &call) {
+      original = *Slot;
+      *Slot = &call;
+    }
+  }
+};
+#define COUNT_GL(name)                                                         \
+  gl_counter<&glad_##name, decltype(glad_##name)>::install()
+
+void countGlCalls() {
+  COUNT_GL(glBindBuffer);
+  COUNT_GL(glBindFramebuffer);
+  COUNT_GL(glBindTexture);
+  COUNT_GL(glBindVertexArray);
+  COUNT_GL(glBlendFunc);
+  COUNT_GL(glBlitFramebuffer);
+  COUNT_GL(glBufferData);
+  COUNT_GL(glBufferSubData);
+  COUNT_GL(glClear);
+  COUNT_GL(glDisable);
+  COUNT_GL(glDrawArrays);
+  COUNT_GL(glDrawArraysInstanced);
+  COUNT_GL(glDrawElements);
+  COUNT_GL(glDrawElementsInstanced);
+  COUNT_GL(glEnable);
+  COUNT_GL(glFinish);
+  COUNT_GL(glGetIntegerv);
+  COUNT_GL(glGetUniformLocation);
+  COUNT_GL(glPolygonMode);
+  COUNT_GL(glProgramUniform1f);
+  COUNT_GL(glProgramUniform1i);
+  COUNT_GL(glProgramUniform3fv);
+  COUNT_GL(glProgramUniform4fv);
+  COUNT_GL(glProgramUniformMatrix4fv);
+  COUNT_GL(glTexImage2D);
+  COUNT_GL(glTexSubImage2D);
+  COUNT_GL(glUniform1i);
+  COUNT_GL(glUniformMatrix4fv);
+  COUNT_GL(glUseProgram);
+  COUNT_GL(glViewport);
+}
+#undef COUNT_GL
+
+template <typename T> inline void doNotOptimize(T const &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct result {
+  std::string name;
+  std::uint64_t iterations;
+  double ns_per_op;
+  double allocations_per_op;
+  double gl_calls_per_op;
+};
+
+// GPU memory taken by one mesh in the original and the packed format
+struct mesh_size {
+  std::string name;
+  std::size_t datapack_bytes;
+  std::size_t packed_vertex_bytes;
+  std::size_t index_bytes;
+};
+
+std::string_view filter;
+double min_time = 0.5;
+std::vector<result> results;
+std::vector<mesh_size> meshes;
+
+// Runs `op` until at least min_time seconds have been spent in it
+template <typename F> void bench(std::string_view name, F &&op) {
+  if (name.find(filter) == std::string_view::npos) {
+    return;
+  }
+
+  using clock = std::chrono::steady_clock;
+  const auto run = [&](std::uint64_t iterations) {
+    const auto start = clock::now();
+    for (std::uint64_t i = 0; i < iterations; i++) {
+      op();
+    }
+    return std::chrono::duration<double>(clock::now() - start).count();
+  };
+
+  // warm up and find an iteration count that takes a measurable time
+  std::uint64_t iterations = 1;
+  double elapsed = run(iterations);
+  while (elapsed < min_time / 10 && iterations < (1ull << 40)) {
+    iterations *= 2;
+    elapsed = run(iterations);
+  }
+  iterations = std::max<std::uint64_t>(
+      1, static_cast<std::uint64_t>(iterations * (min_time / elapsed)));
+
+  const std::uint64_t allocations_before = heapAllocations();
+  const std::uint64_t gl_calls_before = gl_calls;
+  elapsed = run(iterations);
+  const double n = static_cast<double>(iterations);
+  results.push_back({std::string{name}, iterations, elapsed * 1e9 / n,
+                     (heapAllocations() - allocations_before) / n,
+                     (gl_calls - gl_calls_before) / n});
+  std::fprintf(stderr, "%-32s %12.1f ns/op\n", results.back().name.c_str(),
+               results.back().ns_per_op);
+}
+
+void printJson() {
+  std::printf("{\n  \"benchmarks\": [\n");
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const result &r = results[i];
+    std::printf("    {\"name\": \"%s\", \"iterations\": %llu, "
+                "\"ns_per_op\": %.3f, \"allocations_per_op\": %.3f, "
+                "\"gl_calls_per_op\": %.3f}%s\n",
+                r.name.c_str(), static_cast<unsigned long long>(r.iterations),
+                r.ns_per_op, r.allocations_per_op, r.gl_calls_per_op,
+                i + 1 < results.size() ? "," : "");
+  }
+  std::printf("  ],\n  \"meshes\": [\n");
+  for (std::size_t i = 0; i < meshes.size(); i++) {
+    const mesh_size &m = meshes[i];
+    std::printf("    {\"name\": \"%s\", \"datapack_bytes\": %zu, "
+                "\"packed_vertex_bytes\": %zu, \"index_bytes\": %zu, "
+                "\"reduction\": %.2f}%s\n",
+                m.name.c_str(), m.datapack_bytes, m.packed_vertex_bytes,
+                m.index_bytes,
+                double(m.datapack_bytes) /
+                    (m.packed_vertex_bytes + m.index_bytes),
+                i + 1 < meshes.size() ? "," : "");
+  }
+  std::printf("  ]\n}\n");
+}
+
+void meshSizes() {
+  const auto add = [](const char *name, std::vector<datapack> const &mesh) {
+    const packed_mesh packed = packMesh(mesh);
+    meshes.push_back({name, mesh.size() * sizeof(datapack),
+                      packed.vertices.size() * sizeof(packed_vertex),
+                      packed.indices.size() * sizeof(std::uint16_t)});
+  };
+  add("dial", genCompleteBase());
+  add("needle", genNeedle());
+}
+
+// The compile time dial has to match what genCompleteBase() computes at
+// runtime
+bool dialMeshMatchesRuntime() {
+  const std::vector<datapack> runtime = genCompleteBase();
+  if (runtime.size() != dial_mesh::SIZE) {
+    return false;
+  }
+  constexpr float TOLERANCE = 1e-5f;
+  for (std::size_t i = 0; i < runtime.size(); i++) {
+    const dial_mesh::vertex &v = dial_mesh::VERTICES[i];
+    const glm::vec3 pos{v.x, v.y, v.layer};
+    const glm::vec3 color{v.r, v.g, v.b};
+    if (glm::any(glm::greaterThan(glm::abs(pos - runtime[i].pos),
+                                  glm::vec3{TOLERANCE})) ||
+        glm::any(glm::greaterThan(glm::abs(color - runtime[i].color),
+                                  glm::vec3{TOLERANCE}))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void cpuBenchmarks() {
+  if (!dialMeshMatchesRuntime()) {
+    std::fprintf(stderr, "dial_mesh: differs from genCompleteBase()\n");
+    std::abort();
+  }
+
+  bench("geometry/genCompleteBase", [] { doNotOptimize(genCompleteBase()); });
+  bench("geometry/genNeedle", [] { doNotOptimize(genNeedle()); });
+  const std::vector<datapack> base = genCompleteBase();
+  bench("geometry/packMesh_dial", [&] { doNotOptimize(packMesh(base)); });
+
+  float hue = 0;
+  bench("math/Hue", [&] {
+    doNotOptimize(Hue(hue));
+    hue += 1.0f;
+  });
+
+  float rpm = 0;
+  bench("math/map", [&] {
+    doNotOptimize(map<float>(rpm, RPM_MIN, RPM_MAX, -NEEDLE_RANGE / 2.0f,
+                             NEEDLE_RANGE / 2.0f));
+    rpm += 1.0f;
+  });
+  bench("math/needle_angle", [&] {
+    doNotOptimize(gauge_renderer::needle_angle(rpm));
+    rpm += 1.0f;
+  });
+}
+
+// Startup cost of the font atlas, rasterized with FreeType and mapped from the
+// disk cache, checking the cached copy matches what was rasterized
+void atlasBenchmarks() {
+  const char *font = text_renderer::FONT_PATH;
+  const int pixel_size = text_renderer::FONT_PIXEL_SIZE;
+  const glyph_format coverage = glyph_format::coverage;
+  glyph_atlas atlas;
+  if (!rasterizeAtlas(font, text_renderer::SDF_PIXEL_SIZE, glyph_format::sdf,
+                      atlas)) {
+    std::fprintf(stderr, "no font, skipping atlas benchmarks\n");
+    return;
+  }
+  bench("text/rasterize_sdf_atlas", [&] {
+    doNotOptimize(rasterizeAtlas(font, text_renderer::SDF_PIXEL_SIZE,
+                                 glyph_format::sdf, atlas));
+  });
+  bench("text/rasterize_atlas", [&] {
+    doNotOptimize(rasterizeAtlas(font, pixel_size, coverage, atlas));
+  });
+
+  char cache_dir[] = "/tmp/gauge_bench_atlas_XXXXXX";
+  glyph_cache &cache = glyph_cache::current();
+  if (!mkdtemp(cache_dir) || !cache.open(cache_dir)) {
+    return;
+  }
+  cache.store(font, pixel_size, coverage, atlas);
+  glyph_cache::view view;
+  if (!cache.find(font, pixel_size, coverage, view) ||
+      cache.find(font, pixel_size, glyph_format::sdf, view) ||
+      !cache.find(font, pixel_size, coverage, view) ||
+      view.size() != atlas.size ||
+      view.glyphs().size() != atlas.glyphs.size() ||
+      !std::equal(atlas.pixels.begin(), atlas.pixels.end(), view.pixels())) {
+    std::fprintf(stderr, "glyph_cache: cached atlas differs\n");
+    std::abort();
+  }
+  bench("text/cached_atlas_map", [&] {
+    doNotOptimize(cache.find(font, pixel_size, coverage, view));
+    // touch every page, an upload would read all of it
+    unsigned sum = 0;
+    for (int i = 0; i < view.size() * view.size(); i += 4096) {
+      sum += view.pixels()[i];
+    }
+    doNotOptimize(sum);
+  });
+  view.close();
+  cache.close();
+  std::filesystem::remove_all(cache_dir);
+}
+
+// Checks the needle models against their closed form step responses and that
+// the state only depends on the number of fixed steps, not on the frame times
+// they were run at, then times them
+void dynamicsBenchmarks() {
+  const auto fail = [](const char *what, double got, double expected) {
+    std::fprintf(stderr, "needle_dynamics: %s is %f, expected %f\n", what, got,
+                 expected);
+    std::abort();
+  };
+  constexpr float TARGET = 3000.0f;
+
+  needle_dynamics::params spring;
+  spring.frequency_hz = 2.0f;
+  spring.damping = 0.5f;
+  needle_dynamics::state s;
+  float peak = 0;
+  for (float t = 0; t < 3.0f; t += spring.step) {
+    s = needle_dynamics::step(spring, s, TARGET);
+    peak = std::max(peak, s.rpm);
+  }
+  const double overshoot =
+      std::exp(-M_PI * spring.damping /
+               std::sqrt(1.0 - spring.damping * spring.damping));
+  if (std::abs(peak / TARGET - 1.0 - overshoot) > 0.02) {
+    fail("spring overshoot", peak / TARGET - 1.0, overshoot);
+  }
+  if (std::abs(s.rpm - TARGET) > TARGET * 0.01f) {
+    fail("spring after 3 s", s.rpm, TARGET);
+  }
+
+  needle_dynamics::params lag;
+  lag.kind = needle_dynamics::model::lag;
+  lag.time_constant = 24 * lag.step;
+  s = {};
+  for (int i = 0; i < 24; i++) {
+    s = needle_dynamics::step(lag, s, TARGET);
+  }
+  if (std::abs(s.rpm / TARGET - (1.0 - std::exp(-1.0))) > 1e-4) {
+    fail("lag after one time constant", s.rpm / TARGET, 1.0 - std::exp(-1.0));
+  }
+
+  // The same 5.5 s of wall time at every frame rate has to run the same
+  // steps and end on the same state, bit for bit. Frame times are taken
+  // between clock readings, like the window does, so they add up to exactly
+  // 5.5 s even where the period is not a whole number of nanoseconds.
+  constexpr std::chrono::nanoseconds WALL_TIME{5'500'000'000};
+  const int frame_counts[] = {165, 330, 792, 500}; // 30, 60, 144 Hz, 11 ms
+  int reference_steps = -1;
+  needle_dynamics::state reference;
+  for (const int frames : frame_counts) {
+    needle_dynamics needle;
+    needle.configure(spring);
+    needle.reset(0);
+    int steps = 0;
+    std::chrono::nanoseconds last{0};
+    for (int i = 1; i <= frames; i++) {
+      const std::chrono::nanoseconds now = WALL_TIME * i / frames;
+      steps += needle.advance(TARGET, now - last);
+      last = now;
+    }
+    if (reference_steps < 0) {
+      reference_steps = steps;
+      reference = needle.current();
+    } else if (steps != reference_steps) {
+      fail("steps in 5.5 s", steps, reference_steps);
+    } else if (needle.current().rpm != reference.rpm ||
+               needle.current().velocity != reference.velocity) {
+      fail("rpm after 5.5 s", needle.current().rpm, reference.rpm);
+    }
+  }
+
+  s = {};
+  bench("dynamics/step_spring", [&] {
+    s = needle_dynamics::step(spring, s, TARGET);
+    doNotOptimize(s);
+  });
+  bench("dynamics/step_lag", [&] {
+    s = needle_dynamics::step(lag, s, TARGET);
+    doNotOptimize(s);
+  });
+  needle_dynamics needle;
+  needle.configure(spring);
+  bench("dynamics/advance_60hz_frame", [&] {
+    needle.advance(TARGET, std::chrono::nanoseconds(1'000'000'000 / 60));
+    doNotOptimize(needle.interpolated());
+  });
+}
+
+void telemetryBenchmarks() {
+  // stress test: a consumer thread drains as fast as it can and checks that
+  // every sample arrives exactly once and in order while we push
+  static telemetry_ring ring;
+  std::atomic<bool> quit{false};
+  std::int64_t pushed = 0;
+  std::thread consumer([&] {
+    std::int64_t expected = 0;
+    const auto check = [&](telemetry_sample const &sample) {
+      if (sample.time_ns != expected++) {
+        std::fprintf(stderr, "spsc_ring: got sample %lld, expected %lld\n",
+                     static_cast<long long>(sample.time_ns),
+                     static_cast<long long>(expected - 1));
+        std::abort();
+      }
+    };
+    while (!quit.load(std::memory_order_relaxed)) {
+      ring.drain(check);
+    }
+    ring.drain(check);
+  });
+
+  bench("telemetry/spsc_push_throughput", [&] {
+    const telemetry_sample sample{pushed, 1.0f, 2.0f};
+    while (!ring.try_push(sample)) {
+    }
+    pushed++;
+  });
+
+  quit = true;
+  consumer.join();
+
+  // what the main loop pays per frame to read the shared memory channel
+  // while a writer hammers it from another thread
+  static seqlock<telemetry_sample> latest;
+  quit = false;
+  std::thread writer([&] {
+    std::int64_t i = 0;
+    while (!quit.load(std::memory_order_relaxed)) {
+      latest.store({i, static_cast<float>(i), static_cast<float>(-i)});
+      i++;
+    }
+  });
+  bench("telemetry/seqlock_read_contended", [&] {
+    telemetry_sample sample;
+    if (!latest.load(sample)) {
+      return;
+    }
+    // every field has to come from the same store
+    if (sample.rpm != static_cast<float>(sample.time_ns) ||
+        sample.hours != -sample.rpm) {
+      std::fprintf(stderr, "seqlock: torn read\n");
+      std::abort();
+    }
+    doNotOptimize(sample);
+  });
+  quit = true;
+  writer.join();
+
+  bench("telemetry/seqlock_read_idle", [&] {
+    telemetry_sample sample;
+    doNotOptimize(latest.load(sample));
+    doNotOptimize(sample);
+  });
+
+  // an hour long engine run sampled at 1 kHz
+  static constexpr std::int64_t LOG_SAMPLES = 3600 * 1000;
+  static constexpr std::int64_t LOG_PERIOD_NS = 1000000;
+  if (std::string_view{"telemetry/log_seek"}.find(filter) !=
+      std::string_view::npos) {
+    char path[] = "/tmp/gauge_bench_log_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd >= 0) {
+      close(fd);
+      telemetry_recorder recorder;
+      recorder.open(path);
+      for (std::int64_t i = 0; i < LOG_SAMPLES; i++) {
+        recorder.append({i * LOG_PERIOD_NS, 0.0f, 0.0f});
+      }
+      recorder.close();
+
+      telemetry_replay replay;
+      replay.open(path);
+      std::uint64_t seed = 1;
+      bench("telemetry/log_seek", [&] {
+        // xorshift, so the lookups are spread over the whole log
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        const std::int64_t t = seed % (LOG_SAMPLES * LOG_PERIOD_NS);
+        doNotOptimize(replay.seek(t));
+      });
+      replay.close();
+      unlink(path);
+    }
+  }
+}
+
+void glBenchmarks() {
+  static constexpr int WIDTH = 1280, HEIGHT = 720;
+
+  headless_context context;
+  if (!context.create(WIDTH, HEIGHT)) {
+    std::fprintf(stderr, "no OpenGL context, skipping GL benchmarks\n");
+    return;
+  }
+  countGlCalls();
+
+  // startup cost of one program, from source and from the binary cache
+  bench("program/compile", [] {
+    glDeleteProgram(genShapeRenderingProgram());
+  });
+  char cache_dir[] = "/tmp/gauge_bench_programs_XXXXXX";
+  program_cache &programs = program_cache::current();
+  if (mkdtemp(cache_dir) && programs.open(cache_dir)) {
+    bench("program/binary_load", [] {
+      glDeleteProgram(genShapeRenderingProgram());
+    });
+    programs.close();
+    std::filesystem::remove_all(cache_dir);
+  }
+
+  gauge_renderer gauge;
+  gauge.allocate();
+  // every frame benchmark draws the labels too
+  gauge.text.finish_loading();
+  glClearColor(0.2, 0.2, 0.2, 1.0);
+
+  // layout only: everything text_renderer does per label before touching GL
+  bench("text/layout_notch_labels", [&] {
+    for (int i = 0; i <= RPM_MAX / (RPM_STEP * 5); i++) {
+      char label[16];
+      std::snprintf(label, sizeof(label), "%d", i * RPM_STEP * 5 / 100);
+      gauge.text.queue(label, 100.0f, 100.0f, 0.5f);
+    }
+    gauge.text.clear();
+  });
+  // the same labels from text_layouts, what a steady state frame does
+  std::vector<text_layout> notch_labels(RPM_MAX / (RPM_STEP * 5) + 1);
+  for (std::size_t i = 0; i < notch_labels.size(); i++) {
+    notch_labels[i].set(std::to_string(i * RPM_STEP * 5 / 100), 100.0f,
+                        100.0f, 0.5f);
+  }
+  bench("text/queue_cached_notch_labels", [&] {
+    for (text_layout &label : notch_labels) {
+      gauge.text.queue(label);
+    }
+    gauge.text.clear();
+  });
+  bench("text/layout_hours", [&] {
+    gauge.text.queue("Hours 1234.5", 100.0f, 100.0f, 0.5f);
+    gauge.text.clear();
+  });
+  // outside ASCII, hits in the glyph pages after the first iteration
+  bench("text/layout_unicode", [&] {
+    gauge.text.queue("\u0442\u044b\u0441. \u043e\u0431/\u043c\u0438\u043d "
+                     "90\u00b0 5\u00b5s",
+                     100.0f, 100.0f, 0.5f);
+    gauge.text.clear();
+  });
+  // far more distinct glyphs than fit, every one a miss that evicts
+  char32_t cjk = 0x4e00;
+  bench("text/layout_unicode_miss", [&] {
+    char label[4] = {char(0xe0 | (cjk >> 12)), char(0x80 | ((cjk >> 6) & 0x3f)),
+                     char(0x80 | (cjk & 0x3f)), 0};
+    gauge.text.queue(label, 100.0f, 100.0f, 0.5f);
+    gauge.text.clear();
+    cjk = cjk == 0x9fff ? 0x4e00 : cjk + 1;
+    if (gauge.text.cached_glyphs() > gauge.text.glyph_capacity()) {
+      std::fprintf(stderr, "text_renderer: %zu glyphs cached, unbounded\n",
+                   gauge.text.cached_glyphs());
+      std::abort();
+    }
+  });
+
+  gauge_renderer::frame f{WIDTH, HEIGHT};
+  const auto frame = [&](bool finish) {
+    return [&, finish] {
+      f.rpm = std::fmod(f.rpm + 7.0f, static_cast<float>(RPM_MAX));
+      glClear(GL_COLOR_BUFFER_BIT);
+      gauge.draw(f);
+      if (finish) {
+        context.finish();
+      }
+    };
+  };
+
+  // submission cost only, the driver may still be working on earlier frames
+  f.batch_text = true;
+  bench("frame/submit", frame(false));
+  f.batch_text = false;
+  bench("frame/submit_unbatched_text", frame(false));
+  context.finish();
+
+  // the analytic dial against the meshes, text is the same for both
+  f.batch_text = true;
+  f.mode = gauge_renderer::dial_mode::sdf;
+  bench("frame/submit_sdf", frame(false));
+  context.finish();
+  f.mode = gauge_renderer::dial_mode::mesh;
+
+  // submission plus rendering, what the headless mode measures
+  bench("frame/complete", frame(true));
+  f.cache_static = false;
+  bench("frame/complete_uncached", frame(true));
+  f.cache_static = true;
+  f.mode = gauge_renderer::dial_mode::sdf;
+  bench("frame/complete_sdf", frame(true));
+
+  // Once warmed up a frame must not touch the heap, whatever changes from
+  // frame to frame (needle and hours here) included
+  const auto expect_no_allocations = [&](const char *what) {
+    f.hours = 1000.0f; // the widest the hours label gets below
+    for (int i = 0; i < 10; i++) {
+      frame(true)();
+    }
+    const std::uint64_t before = heapAllocations();
+    for (int i = 0; i < 100; i++) {
+      f.hours += 0.1f;
+      frame(true)();
+    }
+    if (heapAllocations() != before) {
+      std::fprintf(stderr, "frame: %s made %llu allocations in 100 frames\n",
+                   what,
+                   static_cast<unsigned long long>(heapAllocations() -
+                                                   before));
+      std::abort();
+    }
+  };
+  expect_no_allocations("sdf dial");
+  f.mode = gauge_renderer::dial_mode::mesh;
+  expect_no_allocations("cached mesh dial");
+  f.cache_static = false;
+  expect_no_allocations("mesh dial");
+  f.batch_text = false;
+  expect_no_allocations("unbatched text");
+  f.batch_text = true;
+  f.cache_static = true;
+  gauge.destroy();
+
+  // the same frames with distance field labels
+  gauge.allocate(glyph_format::sdf);
+  gauge.text.finish_loading();
+  f.mode = gauge_renderer::dial_mode::mesh;
+  f.cache_static = false;
+  bench("frame/complete_sdf_text", frame(true));
+  gauge.destroy();
+
+  // frame time against gauge count, two draw calls whatever the count
+  dashboard wall;
+  wall.allocate();
+  // a grid of mixed ranges and sweeps, as a wall of different engines
+  const auto lay_out = [](std::vector<dashboard::gauge> &gauges) {
+    layOutGrid(gauges, WIDTH, HEIGHT);
+    for (std::size_t i = 0; i < gauges.size(); i++) {
+      gauges[i].max = RPM_MAX * (1 + i % 4) / 4.0f;
+      gauges[i].sweep = NEEDLE_RANGE - 30.0f * (i % 3);
+    }
+  };
+  const auto expect_two_draw_calls = [&](std::size_t count) {
+    const dashboard::stats stats = wall.reset_stats();
+    if (stats.draw_calls * count != stats.gauges * 2) {
+      std::fprintf(stderr, "dashboard: %zu draw calls for %zu gauges\n",
+                   stats.draw_calls, stats.gauges);
+      std::abort();
+    }
+  };
+  for (int count : {1, 10, 50, 100, 500, 1000, 10000}) {
+    std::vector<dashboard::gauge> gauges(count);
+    lay_out(gauges);
+    wall.set_gauges(gauges);
+    std::vector<float> values(count);
+    float t = 0;
+    bench("dashboard/complete_" + std::to_string(count), [&] {
+      t += 0.01f;
+      for (std::size_t i = 0; i < values.size(); i++) {
+        values[i] = map<float>(std::sin(t + i * 0.1f), -1, 1, RPM_MIN,
+                               RPM_MAX);
+      }
+      glClear(GL_COLOR_BUFFER_BIT);
+      wall.draw(values, WIDTH, HEIGHT);
+      context.finish();
+    });
+    expect_two_draw_calls(count);
+  }
+
+  // CPU cost of moving the needles: mapping every value to an angle and
+  // uploading whole instances, against uploading the raw values alone
+  for (int count : {1, 100, 10000}) {
+    std::vector<dashboard::gauge> gauges(count);
+    lay_out(gauges);
+    std::vector<float> values(count);
+    float value = 0;
+    bench("dashboard/submit_cpu_mapping_" + std::to_string(count), [&] {
+      value = std::fmod(value + 7.0f, static_cast<float>(RPM_MAX));
+      for (dashboard::gauge &g : gauges) {
+        g.value = value;
+      }
+      wall.draw(gauges, WIDTH, HEIGHT);
+    });
+    context.finish();
+    wall.set_gauges(gauges);
+    bench("dashboard/submit_gpu_mapping_" + std::to_string(count), [&] {
+      value = std::fmod(value + 7.0f, static_cast<float>(RPM_MAX));
+      for (float &v : values) {
+        v = value;
+      }
+      wall.draw(values, WIDTH, HEIGHT);
+    });
+    context.finish();
+    expect_two_draw_calls(count);
+  }
+  wall.destroy();
+
+  context.destroy();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg == "--filter" && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (arg == "--min-time" && i + 1 < argc) {
+      min_time = std::atof(argv[++i]);
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--filter SUBSTRING] [--min-time SECONDS]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  meshSizes();
+  cpuBenchmarks();
+  atlasBenchmarks();
+  dynamicsBenchmarks();
+  telemetryBenchmarks();
+  glBenchmarks();
+  printJson();
+  return 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Dial layout and range, shared by everything that needs to know what the
+// gauge shows without pulling in any GL headers
+
+static constexpr int RPM_MIN = 0;
+static constexpr int RPM_MAX = 3500;
+static constexpr int RPM_STEP = 100;
+
+static constexpr int NOTCHES = 8;
+static constexpr float NOTCH_MAX = 0.90;
+static constexpr float NOTCH_MAX_SMALL = 0.80;
+static constexpr float NOTCH_MIN = 0.70;
+static constexpr float NOTCH_WIDTH = 0.002;
+
+static constexpr float NEEDLE_RANGE = 270;
+
+static constexpr float DIAMETER = 0.75;
+static constexpr float NEEDLE_WIDTH = 0.015;
+static constexpr float NEEDLE_LENGTH = 0.6;
+static constexpr float NEEDLE_OFFSET = 0.01;
+
+// Smallest rpm change worth redrawing for, moves the needle a tenth of a
+// degree
+static constexpr float RPM_EPSILON = 0.1f * (RPM_MAX - RPM_MIN) / NEEDLE_RANGE;
+
+template <typename T>
+constexpr T map(T x, T x_low, T x_high, T t_low, T t_high) {
+  return (x - x_low) * (t_high - t_low) / (x_high - x_low) + t_low;
+}
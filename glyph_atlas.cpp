@@ -0,0 +1,373 @@
+#include "glyph_atlas.hpp"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_MODULE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#include "hash.hpp"
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+static constexpr int ATLAS_MIN_SIZE = 256;
+static constexpr int ATLAS_PADDING = 1;
+
+bool glyph_rasterizer::open(const char *font_path, int pixel_size,
+                            glyph_format glyphs) {
+  close();
+  if (FT_Init_FreeType(&library)) {
+    library = nullptr;
+    return false;
+  }
+  format = glyphs;
+  if (format == glyph_format::sdf) {
+    const FT_Int spread = SDF_SPREAD;
+    FT_Property_Set(library, "sdf", "spread", &spread);
+  }
+  if (FT_New_Face(library, font_path, 0, &face)) {
+    std::fprintf(stderr, "%s: cannot load font\n", font_path);
+    face = nullptr;
+    close();
+    return false;
+  }
+  FT_Set_Pixel_Sizes(face, 0, pixel_size);
+  return true;
+}
+
+void glyph_rasterizer::close() {
+  if (face) {
+    FT_Done_Face(face);
+    face = nullptr;
+  }
+  if (library) {
+    FT_Done_FreeType(library);
+    library = nullptr;
+  }
+}
+
+bool glyph_rasterizer::render(char32_t codepoint, bitmap &out) {
+  if (format == glyph_format::sdf) {
+    // from the outline, the bitmap grows by SDF_SPREAD on every side and the
+    // bearing moves to match
+    if (FT_Load_Char(face, codepoint, FT_LOAD_DEFAULT) ||
+        FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF)) {
+      return false;
+    }
+  } else if (FT_Load_Char(face, codepoint, FT_LOAD_RENDER)) {
+    return false;
+  }
+  const FT_Bitmap &bitmap = face->glyph->bitmap;
+  // FreeType rows may be padded, copy them out tightly packed
+  out.pixels.resize(bitmap.width * bitmap.rows);
+  for (unsigned int row = 0; row < bitmap.rows; row++) {
+    std::copy_n(bitmap.buffer + row * bitmap.pitch, bitmap.width,
+                out.pixels.begin() + row * bitmap.width);
+  }
+  out.details = {
+      {},
+      {},
+      glm::ivec2(bitmap.width, bitmap.rows),
+      glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
+      static_cast<unsigned int>(face->glyph->advance.x)};
+  return true;
+}
+
+bool rasterizeAtlas(const char *font_path, int pixel_size, glyph_format format,
+                    glyph_atlas &out) {
+  glyph_rasterizer rasterizer;
+  if (!rasterizer.open(font_path, pixel_size, format)) {
+    return false;
+  }
+
+  // rasterize every glyph up front so they can be packed into one atlas
+  std::vector<glyph_rasterizer::bitmap> glyphs(128);
+  std::vector<stbrp_rect> rects;
+  for (unsigned char c = 0; c < 128; c++) {
+    if (!rasterizer.render(c, glyphs[c])) {
+      continue;
+    }
+    // one texel of padding keeps linear filtering from bleeding neighbours in
+    const glm::ivec2 size = glyphs[c].details.Size;
+    stbrp_rect rect{};
+    rect.id = c;
+    rect.w = static_cast<stbrp_coord>(size.x + ATLAS_PADDING);
+    rect.h = static_cast<stbrp_coord>(size.y + ATLAS_PADDING);
+    rects.push_back(rect);
+  }
+  rasterizer.close();
+
+  // grow the atlas until every glyph fits
+  int atlas_size = ATLAS_MIN_SIZE;
+  for (;;) {
+    std::vector<stbrp_node> nodes(atlas_size);
+    stbrp_context context;
+    stbrp_init_target(&context, atlas_size, atlas_size, nodes.data(),
+                      static_cast<int>(nodes.size()));
+    if (stbrp_pack_rects(&context, rects.data(),
+                         static_cast<int>(rects.size()))) {
+      break;
+    }
+    atlas_size *= 2;
+  }
+
+  out.size = atlas_size;
+  out.pixels.assign(atlas_size * atlas_size, 0);
+  out.glyphs.clear();
+  for (const stbrp_rect &rect : rects) {
+    glyph_rasterizer::bitmap &glyph = glyphs[rect.id];
+    const glm::ivec2 size = glyph.details.Size;
+    for (int row = 0; row < size.y; row++) {
+      std::copy_n(glyph.pixels.begin() + row * size.x, size.x,
+                  out.pixels.begin() + (rect.y + row) * atlas_size + rect.x);
+    }
+    glyph.details.UvMin = glm::vec2(rect.x, rect.y) / float(atlas_size);
+    glyph.details.UvMax =
+        glm::vec2(rect.x + size.x, rect.y + size.y) / float(atlas_size);
+    out.glyphs.push_back({static_cast<char>(rect.id), glyph.details});
+  }
+  return true;
+}
+
+void glyph_pages::reset(int atlas_size, int page_extent) {
+  size = atlas_size;
+  page_size = page_extent;
+  const int per_row = size / page_size;
+  pages.assign(per_row * per_row, page{});
+  pinned = 0;
+  for (int i = 0; i < per_row * per_row; i++) {
+    pages[i].origin = glm::ivec2{i % per_row, i / per_row} * page_size;
+  }
+}
+
+void glyph_pages::pin(int extent) {
+  for (page &p : pages) {
+    if (p.origin.x < extent && p.origin.y < extent && !p.pinned) {
+      p.pinned = true;
+      pinned++;
+    }
+  }
+}
+
+bool glyph_pages::add(page &p, glm::ivec2 extent, glm::ivec2 &origin) const {
+  if (p.pinned || p.glyphs.size() >= MAX_GLYPHS) {
+    return false;
+  }
+  // a glyph that does not fit must not use up the rest of the shelf, the
+  // page only changes once it is placed
+  int cursor_x = p.cursor_x, shelf_y = p.shelf_y, shelf_height = p.shelf_height;
+  if (cursor_x + extent.x > page_size) {
+    // next shelf
+    shelf_y += shelf_height;
+    cursor_x = 0;
+    shelf_height = 0;
+  }
+  if (cursor_x + extent.x > page_size || shelf_y + extent.y > page_size) {
+    return false;
+  }
+  origin = p.origin + glm::ivec2{cursor_x, shelf_y};
+  p.cursor_x = cursor_x + extent.x;
+  p.shelf_y = shelf_y;
+  p.shelf_height = std::max(shelf_height, extent.y);
+  return true;
+}
+
+bool glyph_pages::place(char32_t codepoint, glm::ivec2 extent,
+                        std::uint64_t batch, placement &out,
+                        std::vector<char32_t> &evicted) {
+  if (extent.x > page_size || extent.y > page_size) {
+    return false;
+  }
+  page *chosen = nullptr;
+  for (page &p : pages) {
+    const bool fresh = p.glyphs.empty();
+    if (add(p, extent, out.origin)) {
+      chosen = &p;
+      out.fresh = fresh;
+      break;
+    }
+  }
+
+  if (!chosen) {
+    // recycle the page that has gone unused the longest
+    for (page &p : pages) {
+      if (!p.pinned && p.last_used != batch &&
+          (!chosen || p.last_used < chosen->last_used)) {
+        chosen = &p;
+      }
+    }
+    if (!chosen) {
+      return false;
+    }
+    evicted.insert(evicted.end(), chosen->glyphs.begin(),
+                   chosen->glyphs.end());
+    chosen->glyphs.clear();
+    chosen->cursor_x = chosen->shelf_y = chosen->shelf_height = 0;
+    add(*chosen, extent, out.origin);
+    out.fresh = true;
+  }
+
+  chosen->glyphs.push_back(codepoint);
+  chosen->last_used = batch;
+  out.page = static_cast<int>(chosen - pages.data());
+  return true;
+}
+
+namespace {
+constexpr std::uint32_t MAGIC = 0x41544c47; // "GLTA"
+constexpr std::uint32_t VERSION = 1;
+
+// The file is this, the glyphs, then size * size texels
+struct entry_header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t key;
+  std::uint32_t atlas_size;
+  std::uint32_t glyph_count;
+};
+static_assert(std::is_trivially_copyable_v<glyph_atlas::glyph>);
+static_assert(sizeof(entry_header) % alignof(glyph_atlas::glyph) == 0);
+
+std::size_t entrySize(std::uint32_t atlas_size, std::uint32_t glyph_count) {
+  return sizeof(entry_header) + glyph_count * sizeof(glyph_atlas::glyph) +
+         std::size_t{atlas_size} * atlas_size;
+}
+
+// 0 when the font cannot be found, nothing gets cached for it then
+std::uint64_t fontKey(const char *font_path, int pixel_size,
+                      glyph_format format) {
+  struct stat st;
+  if (stat(font_path, &st) != 0) {
+    return 0;
+  }
+  const std::int64_t stamp[] = {
+      static_cast<std::int64_t>(st.st_size),
+      static_cast<std::int64_t>(st.st_mtim.tv_sec),
+      static_cast<std::int64_t>(st.st_mtim.tv_nsec),
+      pixel_size,
+      static_cast<std::int64_t>(format),
+  };
+  return hash64({reinterpret_cast<const char *>(stamp), sizeof(stamp)},
+                hash64(font_path));
+}
+} // namespace
+
+void glyph_cache::view::close() {
+  if (mapping) {
+    munmap(mapping, mapping_size);
+    mapping = nullptr;
+  }
+  atlas_size = 0;
+  entries = {};
+  texels = nullptr;
+}
+
+glyph_cache &glyph_cache::current() {
+  static glyph_cache cache;
+  return cache;
+}
+
+bool glyph_cache::open(std::string path) {
+  close();
+  std::error_code error;
+  if (path.empty() || (!std::filesystem::create_directories(path, error) &&
+                       error)) {
+    std::fprintf(stderr, "glyph_cache: cannot use '%s': %s\n", path.c_str(),
+                 error.message().c_str());
+    return false;
+  }
+  directory = std::move(path);
+  return true;
+}
+
+std::string glyph_cache::entry_path(std::uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "/%016llx.atlas",
+                static_cast<unsigned long long>(key));
+  return directory + name;
+}
+
+bool glyph_cache::find(const char *font_path, int pixel_size,
+                       glyph_format format, view &out) const {
+  out.close();
+  const std::uint64_t key = fontKey(font_path, pixel_size, format);
+  if (!is_open() || key == 0) {
+    return false;
+  }
+
+  const int fd = ::open(entry_path(key).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<std::size_t>(st.st_size) < sizeof(entry_header)) {
+    ::close(fd);
+    return false;
+  }
+  void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  out.mapping = mapping;
+  out.mapping_size = st.st_size;
+
+  const auto *header = static_cast<const entry_header *>(mapping);
+  if (header->magic != MAGIC || header->version != VERSION ||
+      header->key != key ||
+      entrySize(header->atlas_size, header->glyph_count) !=
+          out.mapping_size) {
+    out.close();
+    return false;
+  }
+
+  const auto *glyphs = reinterpret_cast<const glyph_atlas::glyph *>(header + 1);
+  out.atlas_size = static_cast<int>(header->atlas_size);
+  out.entries = {glyphs, header->glyph_count};
+  out.texels = reinterpret_cast<const unsigned char *>(glyphs +
+                                                       header->glyph_count);
+  return true;
+}
+
+void glyph_cache::store(const char *font_path, int pixel_size,
+                        glyph_format format, glyph_atlas const &atlas) const {
+  const std::uint64_t key = fontKey(font_path, pixel_size, format);
+  if (!is_open() || key == 0) {
+    return;
+  }
+
+  // write next to the entry and rename over it, so a concurrent start never
+  // maps half a file
+  const std::string path = entry_path(key);
+  const std::string temp = path + ".tmp";
+  std::FILE *file = std::fopen(temp.c_str(), "wb");
+  if (!file) {
+    return;
+  }
+  const entry_header header{MAGIC, VERSION, key,
+                            static_cast<std::uint32_t>(atlas.size),
+                            static_cast<std::uint32_t>(atlas.glyphs.size())};
+  const bool ok =
+      std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+      std::fwrite(atlas.glyphs.data(), sizeof(glyph_atlas::glyph),
+                  atlas.glyphs.size(), file) == atlas.glyphs.size() &&
+      std::fwrite(atlas.pixels.data(), 1, atlas.pixels.size(), file) ==
+          atlas.pixels.size();
+  if (std::fclose(file) != 0 || !ok ||
+      std::rename(temp.c_str(), path.c_str()) != 0) {
+    std::remove(temp.c_str());
+  }
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace impl {
+struct character_details {
+  glm::vec2 UvMin;      // Top left of the glyph in the atlas
+  glm::vec2 UvMax;      // Bottom right of the glyph in the atlas
+  glm::ivec2 Size;      // Size of glyph
+  glm::ivec2 Bearing;   // Offset from baseline to left/top of glyph
+  unsigned int Advance; // Offset to advance to next glyph
+};
+} // namespace impl
+
+// What the texels of an atlas hold
+enum class glyph_format : std::uint8_t {
+  coverage, // antialiased coverage, sharp only near the rasterized size
+  sdf,      // signed distance to the outline, 128 on it and more inside
+};
+
+// A font rasterized at one pixel size and packed into a single channel
+// texture, everything text_renderer needs to upload it. No GL in here.
+struct glyph_atlas {
+  struct glyph {
+    char c;
+    impl::character_details details;
+  };
+
+  int size{0}; // width and height in texels
+  std::vector<glyph> glyphs;
+  std::vector<unsigned char> pixels; // size * size, row major
+};
+
+// Loads `font_path` with FreeType and packs its ASCII glyphs at `pixel_size`
+bool rasterizeAtlas(const char *font_path, int pixel_size, glyph_format format,
+                    glyph_atlas &out);
+
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+// One FreeType face at one pixel size, rendering single glyphs on demand
+class glyph_rasterizer {
+public:
+  struct bitmap {
+    std::vector<unsigned char> pixels; // Size.x * Size.y, tightly packed
+    impl::character_details details;   // without the atlas coordinates
+  };
+
+  // Texels of distance field around every sdf glyph, enough to antialias
+  // the outline down to 1 / SDF_SPREAD of the rasterized size. FreeType's
+  // cost grows with its square.
+  static constexpr int SDF_SPREAD = 4;
+
+  glyph_rasterizer() = default;
+  glyph_rasterizer(glyph_rasterizer const &) = delete;
+  glyph_rasterizer &operator=(glyph_rasterizer const &) = delete;
+  ~glyph_rasterizer() { close(); }
+
+  bool open(const char *font_path, int pixel_size,
+            glyph_format format = glyph_format::coverage);
+  void close();
+  bool is_open() const { return face != nullptr; }
+
+  // Code points the font lacks render as its .notdef glyph
+  bool render(char32_t codepoint, bitmap &out);
+
+private:
+  FT_LibraryRec_ *library{nullptr};
+  FT_FaceRec_ *face{nullptr};
+  glyph_format format{glyph_format::coverage};
+};
+
+// Space management for a fixed size atlas split into square pages. Glyphs
+// are placed into pages as they are first used; when the atlas is full the
+// least recently used page is recycled with every glyph in it, so the atlas
+// and the glyph lookup stay bounded however many code points show up.
+//
+// Only bookkeeping, the caller uploads (and clears) the texels.
+class glyph_pages {
+public:
+  // glyphs per page, bounds the lookup even for glyphs with no pixels
+  static constexpr std::size_t MAX_GLYPHS = 64;
+
+  struct placement {
+    glm::ivec2 origin; // top left in the atlas, in texels
+    int page;
+    bool fresh; // the page was empty, its texels may hold anything
+  };
+
+  void reset(int atlas_size, int page_size);
+  int atlas_size() const { return size; }
+  // glyphs the atlas can ever hold at once, pinned pages hold none
+  std::size_t capacity() const {
+    return (pages.size() - pinned) * MAX_GLYPHS;
+  }
+
+  // Keeps the pages covering the top left `extent` texels, i.e. a preloaded
+  // atlas, out of use forever
+  void pin(int extent);
+  // Marks `page` as used by `batch`
+  void touch(int page, std::uint64_t batch) { pages[page].last_used = batch; }
+  // Finds room for a glyph of `extent` texels. Pages touched by `batch` are
+  // never recycled since queued quads still point into them, the code points
+  // of a recycled page are appended to `evicted`. False when nothing is free.
+  bool place(char32_t codepoint, glm::ivec2 extent, std::uint64_t batch,
+             placement &out, std::vector<char32_t> &evicted);
+
+private:
+  // filled shelf by shelf, top to bottom
+  struct page {
+    glm::ivec2 origin;
+    int cursor_x{0}, shelf_y{0}, shelf_height{0};
+    std::uint64_t last_used{0};
+    bool pinned{false};
+    std::vector<char32_t> glyphs;
+  };
+
+  int size{0}, page_size{0};
+  std::vector<page> pages;
+  std::size_t pinned{0}; // pages
+
+  // packs a glyph into `p` if there is room
+  bool add(page &p, glm::ivec2 extent, glm::ivec2 &origin) const;
+};
+
+// Rasterized atlases kept on disk, so startup maps a file and uploads it
+// instead of going through FreeType.
+//
+// Entries are keyed by the font's path, size and modification time, the
+// pixel size and the format, so replacing the font or changing the size
+// simply misses.
+class glyph_cache {
+public:
+  // A cached atlas mapped straight from its file, valid until closed
+  class view {
+  public:
+    view() = default;
+    view(view const &) = delete;
+    view &operator=(view const &) = delete;
+    ~view() { close(); }
+
+    void close();
+    bool is_open() const { return mapping != nullptr; }
+
+    int size() const { return atlas_size; }
+    std::span<const glyph_atlas::glyph> glyphs() const { return entries; }
+    const unsigned char *pixels() const { return texels; }
+
+  private:
+    friend class glyph_cache;
+    void *mapping{nullptr};
+    std::size_t mapping_size{0};
+    int atlas_size{0};
+    std::span<const glyph_atlas::glyph> entries;
+    const unsigned char *texels{nullptr};
+  };
+
+  // There is one font cache per process
+  static glyph_cache &current();
+
+  // Enables the cache in `path`, creating the directory if needed
+  bool open(std::string path);
+  void close() { directory.clear(); }
+  bool is_open() const { return !directory.empty(); }
+
+  // Maps the cached atlas for this font and size, false on a miss
+  bool find(const char *font_path, int pixel_size, glyph_format format,
+            view &out) const;
+  void store(const char *font_path, int pixel_size, glyph_format format,
+             glyph_atlas const &atlas) const;
+
+private:
+  std::string directory;
+
+  std::string entry_path(std::uint64_t key) const;
+};
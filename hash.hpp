@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// FNV-1a, 64 bits since these keys name cache files that live for a long
+// time. Chain calls through `seed` to hash several pieces.
+constexpr std::uint64_t hash64(std::string_view str,
+                               std::uint64_t seed = 14695981039346656037ull) {
+  for (char c : str) {
+    seed ^= static_cast<unsigned char>(c);
+    seed *= 1099511628211ull;
+  }
+  return seed;
+}
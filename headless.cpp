@@ -0,0 +1,113 @@
+#include "headless.hpp"
+
+#include <cstdio>
+
+#if GAUGE_HAVE_EGL
+#include <EGL/eglext.h>
+#endif
+
+#include "render_state.hpp"
+
+bool headless_context::create(int width, int height) {
+  bool created = false;
+#if GAUGE_HAVE_EGL
+  created = create_egl();
+#endif
+  if (!created && !create_glfw()) {
+    std::fprintf(stderr, "headless: could not create an OpenGL 4.1 context\n");
+    return false;
+  }
+
+  // there is no default framebuffer to draw into, render to our own
+  glGenFramebuffers(1, &fbo);
+  glGenRenderbuffers(1, &color);
+  glBindRenderbuffer(GL_RENDERBUFFER, color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, color);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::fprintf(stderr, "headless: incomplete framebuffer\n");
+    return false;
+  }
+  glViewport(0, 0, width, height);
+  render_state::current().invalidate();
+  return true;
+}
+
+void headless_context::destroy() {
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteRenderbuffers(1, &color);
+
+#if GAUGE_HAVE_EGL
+  if (context != EGL_NO_CONTEXT) {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+    context = EGL_NO_CONTEXT;
+  }
+#endif
+  if (window) {
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    window = nullptr;
+  }
+}
+
+#if GAUGE_HAVE_EGL
+bool headless_context::create_egl() {
+  display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                  EGL_DEFAULT_DISPLAY, nullptr);
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+    return false;
+  }
+
+  const EGLint config_attribs[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,    //
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, //
+      EGL_NONE,
+  };
+  EGLConfig config;
+  EGLint num_configs = 0;
+  if (!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) ||
+      num_configs == 0 || !eglBindAPI(EGL_OPENGL_API)) {
+    eglTerminate(display);
+    return false;
+  }
+
+  const EGLint context_attribs[] = {
+      EGL_CONTEXT_MAJOR_VERSION, 4, //
+      EGL_CONTEXT_MINOR_VERSION, 1, //
+      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, //
+      EGL_NONE,
+  };
+  context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+  if (context == EGL_NO_CONTEXT ||
+      !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+    eglTerminate(display);
+    context = EGL_NO_CONTEXT;
+    return false;
+  }
+  return gladLoadGL(eglGetProcAddress) != 0;
+}
+#endif
+
+bool headless_context::create_glfw() {
+  if (!glfwInit()) {
+    return false;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1); // macOS supports up to 4.1
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  window = glfwCreateWindow(64, 64, "gauge (headless)", nullptr, nullptr);
+  if (!window) {
+    return false;
+  }
+  glfwMakeContextCurrent(window);
+  // never wait for a vblank that does not exist
+  glfwSwapInterval(0);
+  return gladLoadGL(glfwGetProcAddress) != 0;
+}
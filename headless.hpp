@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#if GAUGE_HAVE_EGL
+#include <EGL/egl.h>
+#endif
+
+// Offscreen GL 4.1 core context rendering into a framebuffer object, for
+// machines without a display or GPU (i.e. Mesa llvmpipe on build machines).
+//
+// Uses an EGL surfaceless context when the build found EGL and the driver
+// offers one, and falls back to an invisible GLFW window otherwise.
+class headless_context {
+public:
+  bool create(int width, int height);
+  void destroy();
+
+  // blocks until everything submitted so far has finished rendering
+  void finish() { glFinish(); }
+
+private:
+#if GAUGE_HAVE_EGL
+  EGLDisplay display{EGL_NO_DISPLAY};
+  EGLContext context{EGL_NO_CONTEXT};
+
+  bool create_egl();
+#endif
+  GLFWwindow *window{nullptr};
+  GLuint fbo{0}, color{0};
+
+  bool create_glfw();
+};
@@ -0,0 +1,43 @@
+#include "layer_cache.hpp"
+
+#include <cassert>
+
+void layer_cache::allocate() {
+  glGenFramebuffers(1, &fbo);
+  glGenRenderbuffers(1, &color);
+}
+
+void layer_cache::destroy() {
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteRenderbuffers(1, &color);
+  width = height = 0;
+}
+
+void layer_cache::begin(int w, int h) {
+  // only read back on a miss, a blit on the hot path reuses it
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+
+  if (w != width || h != height) {
+    width = w;
+    height = h;
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, color);
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+           GL_FRAMEBUFFER_COMPLETE);
+  } else {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  }
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void layer_cache::end() { glBindFramebuffer(GL_FRAMEBUFFER, target); }
+
+void layer_cache::blit() {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+  glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+                    GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glad/gl.h>
+
+// An offscreen copy of the parts of a frame that do not change between
+// frames. Render them once between begin() and end(), then blit() the result
+// into the framebuffer every frame instead of drawing them again.
+//
+// Whether the copy is still current is up to the caller; this only owns the
+// framebuffer and remembers which one to go back to.
+class layer_cache {
+public:
+  void allocate();
+  void destroy();
+
+  // Redirects rendering into the cache, resizing it to match the framebuffer
+  // that was bound. Clears it to the current clear color.
+  void begin(int width, int height);
+  // Back to the framebuffer that was bound before begin()
+  void end();
+  // Copies the cached layer over the whole framebuffer bound at begin()
+  void blit();
+
+private:
+  GLuint fbo{0}, color{0};
+  GLint target{0};
+  int width{0}, height{0};
+};
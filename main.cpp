@@ -1,10 +1,14 @@
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
-#include <iterator>
-#include <map>
-#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <span>
 #include <string_view>
+#include <thread>
+#include <utility>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -14,51 +18,108 @@
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
-#include "imgui_impl_opengl3.h"
 
 #include <vector>
 
-#include "shader.hpp"
+#include "alloc_count.hpp"
+#include "dashboard.hpp"
+#include "gauge.hpp"
+#include "glyph_atlas.hpp"
+#include "headless.hpp"
+#include "needle_dynamics.hpp"
+#include "program_cache.hpp"
+#include "render_state.hpp"
+#include "render_thread.hpp"
+#include "startup_log.hpp"
+#include "telemetry.hpp"
+#include "telemetry_log.hpp"
+#include "telemetry_shm.hpp"
 #include "text_renderer.hpp"
 
-static constexpr int RPM_MIN = 0;
-static constexpr int RPM_MAX = 3500;
-static constexpr int RPM_STEP = 100;
-
-static constexpr int NOTCHES = 8;
-static constexpr float NOTCH_MAX = 0.90;
-static constexpr float NOTCH_MAX_SMALL = 0.80;
-static constexpr float NOTCH_MIN = 0.70;
-static constexpr float NOTCH_WIDTH = 0.002;
-
-static constexpr float NEEDLE_RANGE = 270;
-
-static constexpr float DIAMETER = 0.75;
-static constexpr float NEEDLE_WIDTH = 0.015;
-static constexpr float NEEDLE_LENGTH = 0.6;
-static constexpr float NEEDLE_OFFSET = 0.01;
-
-struct datapack {
-  glm::vec3 pos;
-  glm::vec3 color;
-};
-
-struct vao_vbo {
-  GLuint vao;
-  GLuint vbo;
-};
-
-static std::vector<datapack> genCompleteBase();
-static std::vector<datapack> genNeedle();
-static int genShapeRenderingProgram();
-static int genVao(std::vector<datapack> const &data);
-
-template <typename T>
-constexpr T map(T x, T x_low, T x_high, T t_low, T t_high) {
-  return (x - x_low) * (t_high - t_low) / (x_high - x_low) + t_low;
-}
+static int runHeadless(int frames, int width, int height,
+                       gauge_renderer::dial_mode mode, glyph_format text_format,
+                       bool use_disk_cache, bool check_allocations,
+                       int gauges);
+static void openDiskCaches();
+static void printPercentiles(std::vector<double> samples);
+static void watchWindowEvents(GLFWwindow *window);
+
+// Set by every input and window event, cleared by the main loop
+static bool window_event = true;
+
+int main(int argc, char **argv) {
+  startup_log::begin();
+  bool headless = false;
+  int frames = 1000;
+  int headless_width = 1280, headless_height = 720;
+  const char *shm_name = nullptr;
+  const char *record_path = nullptr;
+  const char *replay_path = nullptr;
+  float replay_speed = 1.0f; // 0 replays one sample per frame
+  gauge_renderer::dial_mode mode = gauge_renderer::dial_mode::mesh;
+  glyph_format text_format = glyph_format::coverage;
+  bool on_demand = true;
+  bool use_disk_cache = true;
+  bool check_allocations = false;
+  int gauges = 0; // headless only, 0 draws the single gauge
+  const auto usage = [&] {
+    std::fprintf(stderr,
+                 "usage: %s [--shm [NAME]] [--record FILE] "
+                 "[--replay FILE [--speed N|max]] "
+                 "[--sdf] [--sdf-text] [--continuous] [--no-disk-cache] "
+                 "[--check-allocations] "
+                 "[--headless [--frames N] [--size WxH] [--gauges N]]\n",
+                 argv[0]);
+    return 1;
+  };
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg == "--headless") {
+      headless = true;
+    } else if (arg == "--frames" && i + 1 < argc) {
+      frames = std::atoi(argv[++i]);
+      if (frames <= 0) {
+        return usage();
+      }
+    } else if (arg == "--gauges" && i + 1 < argc) {
+      gauges = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--size" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &headless_width,
+                      &headless_height) != 2 ||
+          headless_width <= 0 || headless_height <= 0) {
+        return usage();
+      }
+    } else if (arg == "--shm") {
+      shm_name = i + 1 < argc && argv[i + 1][0] == '/'
+                     ? argv[++i]
+                     : telemetry_shm::DEFAULT_NAME;
+    } else if (arg == "--record" && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (arg == "--replay" && i + 1 < argc) {
+      replay_path = argv[++i];
+    } else if (arg == "--speed" && i + 1 < argc) {
+      std::string_view speed = argv[++i];
+      replay_speed = speed == "max" ? 0.0f : std::atof(argv[i]);
+    } else if (arg == "--sdf") {
+      mode = gauge_renderer::dial_mode::sdf;
+    } else if (arg == "--sdf-text") {
+      text_format = glyph_format::sdf;
+    } else if (arg == "--continuous") {
+      on_demand = false;
+    } else if (arg == "--no-disk-cache") {
+      use_disk_cache = false;
+    } else if (arg == "--check-allocations") {
+      check_allocations = true;
+    } else {
+      return usage();
+    }
+  }
+  if (headless) {
+    return runHeadless(frames, headless_width, headless_height, mode,
+                       text_format, use_disk_cache, check_allocations,
+                       gauges);
+  }
 
-int main() {
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1); // macOS supports up to 4.1
@@ -68,322 +129,448 @@ int main() {
   glfwMakeContextCurrent(window);
   int version = gladLoadGL(glfwGetProcAddress);
   glfwFocusWindow(window);
+  startup_log::stage("gl context");
+  if (use_disk_cache) {
+    openDiskCaches();
+  }
 
   IMGUI_CHECKVERSION();
+  countImGuiAllocations();
   ImGui::CreateContext();
 
+  // installed first, ImGui chains its own callbacks in front of these
+  watchWindowEvents(window);
   ImGui_ImplGlfw_InitForOpenGL(window, true);
-  ImGui_ImplOpenGL3_Init("#version 410 core");
-
-  std::vector<datapack> base = genCompleteBase();
-  std::vector<datapack> needle = genNeedle();
-
-  Program program = genShapeRenderingProgram();
+  startup_log::stage("imgui");
 
-  GLuint vao_base = genVao(base);
-  GLuint vao_needle = genVao(needle);
+  // GL lives on the render thread from here on, this one handles events,
+  // telemetry and the UI (GLFW wants events handled on the main thread)
+  render_thread renderer;
+  renderer.set_continuous(!on_demand);
+  renderer.start(window, text_format);
 
-  text_renderer text_renderer;
-  text_renderer.allocate();
-  text_renderer.set_color({0.3, 0.3, 0.3});
-
-  glClearColor(0.2, 0.2, 0.2, 1.0);
+  gauge_theme theme;
   float angle{0}, hours{0};
+  // the needle follows `angle` through the dynamics model unless Direct
+  enum { NEEDLE_DIRECT, NEEDLE_SPRING, NEEDLE_LAG };
+  int needle_model = NEEDLE_SPRING;
+  needle_dynamics::params needle_params;
+  needle_dynamics needle;
+  needle.configure(needle_params);
+  needle.reset(angle);
   bool wireframe{false};
+  bool batch_text{true};
+  bool cache_static{true};
+  bool sdf_dial{mode == gauge_renderer::dial_mode::sdf};
+  bool simulate{false};
   float notch_text_scale = 1.0f;
+  // the slider is one producer, the simulated sensor thread the other; only
+  // one of them pushes at a time
+  telemetry_ring telemetry;
+  simulated_sensor sensor;
+  // an external process publishing through shared memory, see
+  // telemetry_writer
+  telemetry_shm shm;
+  if (shm_name && !shm.open(shm_name)) {
+    return 1;
+  }
+  telemetry_recorder recorder;
+  if (record_path && !recorder.open(record_path)) {
+    return 1;
+  }
+  // replaying a log takes over from every live source
+  telemetry_replay replay;
+  if (replay_path && !replay.open(replay_path)) {
+    return 1;
+  }
+  std::int64_t replay_time = replay.begin_ns();
+  std::size_t replay_cursor = 0;
+
+  // everything shown on the gauge goes through here so it can be recorded
+  const auto show = [&](telemetry_sample const &sample) {
+    angle = sample.rpm;
+    hours = sample.hours;
+    if (recorder.is_open()) {
+      recorder.append(sample);
+    }
+  };
+
+  render_thread::stats render_stats;
+
+  // In on demand mode a frame is only drawn when something visible changed,
+  // the rest of the time the loop sleeps until an event or a producer
+  // (glfwPostEmptyEvent) wakes it up.
+  //
+  // ImGui needs a couple of frames after input for hover/active state to
+  // settle.
+  constexpr int SETTLE_FRAMES = 3;
+  // the rate UI and telemetry are processed at while anything is changing,
+  // the display rate is up to the render thread
+  constexpr auto LOGIC_PERIOD = std::chrono::microseconds(1000000 / 120);
+  auto next_tick = std::chrono::steady_clock::now();
+  int settle = 0;
+  float drawn_rpm = RPM_MIN - 2 * RPM_EPSILON, drawn_hours = -1;
+  bool needle_moving = false;
+  std::size_t frames_drawn = 0, frames_skipped = 0;
+  std::size_t samples = 0;
+  // --check-allocations: heap allocations up to the previous frame, and
+  // frames in a row without input since the labels were loaded
+  constexpr int STEADY_AFTER = 60;
+  std::uint64_t heap_mark = heapAllocations();
+  int steady_frames = 0;
+
+  // process CPU time against wall time, over one second windows and overall
+  const std::clock_t cpu_start = std::clock();
+  const auto wall_start = std::chrono::steady_clock::now();
+  std::clock_t cpu_window = cpu_start;
+  auto wall_window = wall_start;
+  auto last_tick = wall_start;
+  float cpu_percent = 0;
 
   while (!glfwWindowShouldClose(window)) {
+    if (on_demand && settle == 0 && !needle_moving) {
+      // nothing signals a shared memory update, poll it at display rate
+      glfwWaitEventsTimeout(shm.is_open() ? 1.0 / 60.0 : 0.5);
+    } else {
+      std::this_thread::sleep_until(next_tick);
+      glfwPollEvents();
+    }
+    next_tick = std::max(next_tick, std::chrono::steady_clock::now()) +
+                LOGIC_PERIOD;
+    if (std::exchange(window_event, false)) {
+      settle = SETTLE_FRAMES;
+    }
+
+    const auto wall_now = std::chrono::steady_clock::now();
+    if (wall_now - wall_window >= std::chrono::seconds(1)) {
+      const std::clock_t cpu_now = std::clock();
+      cpu_percent =
+          100.0f * (cpu_now - cpu_window) / CLOCKS_PER_SEC /
+          std::chrono::duration<float>(wall_now - wall_window).count();
+      cpu_window = cpu_now;
+      wall_window = wall_now;
+    }
+    // a needle that was at rest has nothing to catch up on, running the time
+    // spent idle would jump it a quarter second towards the new target
+    const auto dt = needle_moving ? wall_now - last_tick
+                                  : std::chrono::steady_clock::duration{0};
+    last_tick = wall_now;
+
+    const bool replaying = replay.is_open() && !replay.samples().empty();
+    if (!replaying) {
+      // newest sample wins, the needle cannot show anything in between anyway
+      samples = telemetry.drain([&](telemetry_sample const &sample) {
+        show(sample);
+      });
+      if (telemetry_sample sample; shm.is_open() && shm.poll(sample)) {
+        show(sample);
+      }
+    }
+
+    // stepped on every wake up, drawn or not, so the motion only depends on
+    // elapsed time
+    float needle_rpm = angle;
+    if (needle_model == NEEDLE_DIRECT) {
+      needle.reset(angle);
+    } else {
+      needle.advance(angle, dt);
+      needle_rpm = needle.interpolated();
+    }
+    needle_moving =
+        std::abs(needle.current().rpm - angle) >= RPM_EPSILON ||
+        std::abs(needle.current().velocity) * needle_params.step >= RPM_EPSILON;
+
+    // replay advances with wall time, it needs every frame
+    const bool value_changed =
+        std::abs(needle_rpm - drawn_rpm) >= RPM_EPSILON ||
+        std::round(hours * 10) != std::round(drawn_hours * 10);
+    if (on_demand && settle == 0 && !value_changed && !replaying) {
+      frames_skipped++;
+      continue;
+    }
+    const bool input_frame = settle > 0;
+    settle = std::max(settle - 1, 0);
+    drawn_rpm = needle_rpm;
+    drawn_hours = hours;
+    frames_drawn++;
+
     int width, height;
     glfwGetFramebufferSize(window, &width, &height);
-    glViewport(0, 0, width, height);
-    text_renderer.set_window_size(width, height);
 
     // Start the Dear ImGui frame
-    ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
-    ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
+    ImGui::Text("UI average %.3f ms/frame (%.1f FPS)",
                 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
-    ImGui::SliderFloat("RPM", &angle, RPM_MIN, RPM_MAX);
-    ImGui::InputFloat("Hours", &hours, 0.1, 1, "%0.1f");
-    ImGui::Checkbox("Wireframe", &wireframe);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    if (wireframe) {
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    if (replaying) {
+      std::span<const telemetry_sample> samples = replay.samples();
+      if (replay_speed > 0) {
+        replay_time += static_cast<std::int64_t>(ImGui::GetIO().DeltaTime *
+                                                 replay_speed * 1e9);
+        replay_cursor = replay.seek(replay_time);
+      } else {
+        replay_cursor = std::min(replay_cursor + 1, samples.size() - 1);
+        replay_time = samples[replay_cursor].time_ns;
+      }
+
+      float position = (replay_time - replay.begin_ns()) * 1e-9f;
+      if (ImGui::SliderFloat("Replay Position (s)", &position, 0,
+                             (replay.end_ns() - replay.begin_ns()) * 1e-9f)) {
+        replay_time =
+            replay.begin_ns() + static_cast<std::int64_t>(position * 1e9);
+        replay_cursor = replay.seek(replay_time);
+      }
+      ImGui::InputFloat("Replay Speed (0 = max)", &replay_speed, 1, 10);
+      angle = samples[replay_cursor].rpm;
+      hours = samples[replay_cursor].hours;
     } else {
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      if (ImGui::Checkbox("Simulated Sensor", &simulate)) {
+        simulate ? sensor.start(telemetry, 1000.0f, hours, glfwPostEmptyEvent)
+                 : sensor.stop();
+      }
+      bool changed = ImGui::SliderFloat("RPM", &angle, RPM_MIN, RPM_MAX);
+      changed |= ImGui::InputFloat("Hours", &hours, 0.1, 1, "%0.1f");
+      if (changed && !sensor.running()) {
+        telemetry.try_push({telemetry_now(), angle, hours});
+      }
+      ImGui::Text("Telemetry: %zu samples this frame", samples);
     }
-
-    glm::mat4 view = glm::identity<glm::mat4>();
-    float scale = 0;
-    if (width > height) {
-      scale = float(height) / float(width);
-      view = glm::scale(view, {scale, 1, 1});
-    } else {
-      scale = float(width) / float(height);
-      view = glm::scale(view, {1, scale, 1});
-    }
-
-#if 1
-    program.use();
-    program.setUniform("view", view);
-    program.setUniform("model", glm::identity<glm::mat4>());
-
-    glBindVertexArray(vao_base);
-    glDrawArrays(GL_TRIANGLES, 0, base.size());
-
-    const float working_angle = map<float>(
-        angle, RPM_MIN, RPM_MAX, -NEEDLE_RANGE / 2.0f, NEEDLE_RANGE / 2.0f);
-    ImGui::Text("Working Angle: %0.3f", working_angle);
-    glm::mat4 model =
-        glm::rotate(glm::identity<glm::mat4>(), glm::radians(working_angle),
-                    glm::vec3(0.0f, 0.0f, -1.0f));
-    program.setUniform("model", model);
-
-    glBindVertexArray(vao_needle);
-    glDrawArrays(GL_TRIANGLES, 0, needle.size());
-#endif
-
-    ImGui::SliderFloat("Notch Text Scale", &notch_text_scale, 0.5, 1.5);
-    for (int i = 0; i <= RPM_MAX / (RPM_STEP * 5); i++) {
-      constexpr float min = 90.0f + (NEEDLE_RANGE / 2.0f);
-      constexpr float max = 90.0f - (NEEDLE_RANGE / 2.0f);
-      const float angle1 = glm::radians(map<float>(
-          i, 0, static_cast<float>(RPM_MAX) / (RPM_STEP * 5), min, max));
-      glm::vec2 pos{std::cos(angle1), std::sin(angle1)};
-      pos = view * glm::vec4(pos * DIAMETER * NOTCH_MAX, 0, 0);
-      pos = map<glm::vec2>(pos, {-1, -1}, {1, 1}, {0, 0}, {width, height});
-
-      std::string label = std::to_string(i * RPM_STEP * 5 / 100);
-      text_renderer.draw(label, pos.x, pos.y, notch_text_scale * scale);
+    ImGui::Checkbox("Redraw On Change Only", &on_demand);
+    renderer.set_continuous(!on_demand);
+    ImGui::Text("CPU: %0.1f%% of one core, %zu frames drawn, %zu skipped",
+                cpu_percent, frames_drawn, frames_skipped);
+    ImGui::Checkbox("Wireframe", &wireframe);
+    ImGui::Checkbox("Batch Text", &batch_text);
+    ImGui::Checkbox("SDF Dial", &sdf_dial);
+    ImGui::Checkbox("Cache Static Layer", &cache_static);
+    ImGui::ColorEdit3("Background", glm::value_ptr(theme.background));
+    ImGui::ColorEdit3("Text", glm::value_ptr(theme.text));
+
+    const char *needle_models[] = {"Direct", "Spring", "Lag"};
+    ImGui::Combo("Needle", &needle_model, needle_models,
+                 IM_ARRAYSIZE(needle_models));
+    if (needle_model == NEEDLE_SPRING) {
+      ImGui::SliderFloat("Frequency (Hz)", &needle_params.frequency_hz, 0.5,
+                         10);
+      ImGui::SliderFloat("Damping", &needle_params.damping, 0.1, 2);
+    } else if (needle_model == NEEDLE_LAG) {
+      ImGui::SliderFloat("Time Constant (s)", &needle_params.time_constant,
+                         0.01, 1);
     }
-
-    glm::vec2 pos =
-        map<glm::vec2>({0, -0.2}, {-1, -1}, {1, 1}, {0, 0}, {width, height});
-
-    char hours_msg[32];
-    std::snprintf(hours_msg, sizeof(hours_msg), "Hours %0.1f", hours);
-    text_renderer.draw(hours_msg, pos.x, pos.y, notch_text_scale * scale);
+    needle_params.kind = needle_model == NEEDLE_LAG
+                             ? needle_dynamics::model::lag
+                             : needle_dynamics::model::spring;
+    needle.configure(needle_params);
+
+    ImGui::Text("Working Angle: %0.3f",
+                gauge_renderer::needle_angle(needle_rpm));
+    ImGui::SliderFloat("Notch Text Scale", &notch_text_scale, 0.25, 4);
+    render_thread::snapshot &next = renderer.back();
+    next.gauge = {width, height, needle_rpm, hours, notch_text_scale,
+                  batch_text};
+    next.gauge.mode = sdf_dial ? gauge_renderer::dial_mode::sdf
+                               : gauge_renderer::dial_mode::mesh;
+    next.gauge.theme = theme;
+    // the cached layer would keep whatever polygon mode it was drawn with
+    next.gauge.cache_static = cache_static && !wireframe;
+    next.wireframe = wireframe;
+
+    // figures from the last frame the render thread finished
+    renderer.latest_stats(render_stats);
+    ImGui::Text("Render thread: %llu frames, %0.3f ms submission",
+                static_cast<unsigned long long>(render_stats.frames),
+                std::chrono::duration<float, std::milli>(
+                    render_stats.frame_time)
+                    .count());
+    ImGui::Text("Text: %zu draw calls, %zu glyphs, %zu re-laid out, "
+                "%0.3f ms CPU",
+                render_stats.text.draw_calls, render_stats.text.glyphs,
+                render_stats.text.layouts,
+                std::chrono::duration<float, std::milli>(
+                    render_stats.text.cpu_time)
+                    .count());
+    ImGui::Text("GL state: %zu calls issued, %zu avoided",
+                render_stats.state.issued, render_stats.state.avoided);
+    ImGui::Text("Static layer: %zu hits, %zu misses",
+                render_stats.cache.cache_hits, render_stats.cache.cache_misses);
 
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-    glfwPollEvents();
-    glfwSwapBuffers(window);
+    next.ui.copy(*ImGui::GetDrawData());
+    renderer.publish();
+
+    // Input, loading the labels and buffers growing to their final size may
+    // allocate, a frame that only shows new values after that must not
+    if (check_allocations) {
+      const std::uint64_t allocated = heapAllocations() - heap_mark;
+      heap_mark += allocated;
+      steady_frames =
+          input_frame || !render_stats.text_loaded ? 0 : steady_frames + 1;
+      if (steady_frames > STEADY_AFTER && allocated > 0) {
+        std::fprintf(stderr, "check-allocations: frame %zu allocated %llu "
+                             "times\n",
+                     frames_drawn, static_cast<unsigned long long>(allocated));
+        std::abort();
+      }
+    }
   }
 
+  const float wall_s = std::chrono::duration<float>(
+                           std::chrono::steady_clock::now() - wall_start)
+                           .count();
+  std::printf("cpu: %0.1f%% of one core over %0.1f s, %zu frames drawn, "
+              "%zu skipped\n",
+              100.0f * (std::clock() - cpu_start) / CLOCKS_PER_SEC / wall_s,
+              wall_s, frames_drawn, frames_skipped);
+
+  renderer.stop();
+  sensor.stop();
+  recorder.close();
   return 0;
 }
 
-static glm::vec3 Hue(float H) {
-  H = map<float>(std::fmodf(H, 360), 0, 360, 0, 1);
-  float R = std::abs(H * 6 - 3) - 1;
-  float G = 2 - std::abs(H * 6 - 2);
-  float B = 2 - std::abs(H * 6 - 4);
-  return glm::clamp(glm::vec3(R, G, B));
+// Shader binaries and the glyph atlas share one directory, entries differ by
+// extension
+static void openDiskCaches() {
+  const std::string path = program_cache::default_path();
+  program_cache::current().open(path);
+  glyph_cache::current().open(path);
 }
 
-static std::vector<datapack> genCompleteBase() {
-  std::vector<datapack> ret;
-
-  const float min = 90.0f + (NEEDLE_RANGE / 2.0f);
-  const float max = 90.0f - (NEEDLE_RANGE / 2.0f);
-  const int STEPS = RPM_MAX / RPM_STEP;
-
-  const float HUE_RED = 0;
-  const float HUE_YELLOW = 60;
-  const float HUE_GREEN = 140;
-
-  constexpr int CIRCLE_DIVISIONS = 64;
-  // build circle
-  for (int i = 0; i < CIRCLE_DIVISIONS; i++) {
-    float o1 = (static_cast<float>(i) / CIRCLE_DIVISIONS) * (2.0f * M_PI);
-    float o2 = (static_cast<float>(i + 1) / CIRCLE_DIVISIONS) * (2.0f * M_PI);
-    ret.emplace_back(glm::vec3{0, 0, 0}, glm::vec3{0.7, 0.7, 0.7});
-    ret.emplace_back(glm::vec3{std::cos(o1), std::sin(o1), 0},
-                     glm::vec3{0.7, 0.7, 0.7});
-    ret.emplace_back(glm::vec3{std::cos(o2), std::sin(o2), 0},
-                     glm::vec3{0.7, 0.7, 0.7});
+// Renders `frames` frames into an offscreen framebuffer as fast as possible
+// and prints frame time percentiles, no display or GPU required. With
+// `gauges` > 0 it draws a dashboard of that many gauges instead of the one.
+static int runHeadless(int frames, int width, int height,
+                       gauge_renderer::dial_mode mode, glyph_format text_format,
+                       bool use_disk_cache, bool check_allocations,
+                       int gauges) {
+  headless_context context;
+  if (!context.create(width, height)) {
+    return 1;
+  }
+  startup_log::stage("gl context");
+  if (use_disk_cache) {
+    openDiskCaches();
   }
 
-  for (int rpm = RPM_MIN; rpm < RPM_MAX; rpm += RPM_STEP) {
-    const float angle1 = glm::radians(map<float>(rpm, 0, RPM_MAX, min, max));
-    const float angle2 =
-        glm::radians(map<float>(rpm + RPM_STEP, 0, RPM_MAX, min, max));
-    const float c1 = std::cos(angle1);
-    const float s1 = std::sin(angle1);
-    const float c2 = std::cos(angle2);
-    const float s2 = std::sin(angle2);
-
-    glm::vec3 color;
-    if (rpm < 500 || (rpm >= 2600 && rpm < 2800)) {
-      color = Hue(HUE_YELLOW);
-    } else if (rpm >= 2800) {
-      color = Hue(HUE_RED);
-    } else {
-      color = Hue(HUE_GREEN);
+  gauge_renderer gauge;
+  gauge.allocate(text_format);
+  dashboard wall;
+  std::vector<float> wall_values(gauges);
+  if (gauges > 0) {
+    wall.allocate();
+    std::vector<dashboard::gauge> wall_gauges(gauges);
+    layOutGrid(wall_gauges, width, height);
+    // a few different ranges, as a wall of mixed engines would have
+    for (int i = 0; i < gauges; i++) {
+      wall_gauges[i].max = RPM_MAX * (1 + i % 4) / 4.0f;
     }
-
-    ret.emplace_back(glm::vec3{c1 * NOTCH_MAX_SMALL, s1 * NOTCH_MAX_SMALL, 1},
-                     color);
-    ret.emplace_back(glm::vec3{c1 * NOTCH_MIN, s1 * NOTCH_MIN, 1}, color);
-    ret.emplace_back(glm::vec3{c2 * NOTCH_MIN, s2 * NOTCH_MIN, 1}, color);
-
-    ret.emplace_back(glm::vec3{c1 * NOTCH_MAX_SMALL, s1 * NOTCH_MAX_SMALL, 1},
-                     color);
-    ret.emplace_back(glm::vec3{c2 * NOTCH_MAX_SMALL, s2 * NOTCH_MAX_SMALL, 1},
-                     color);
-    ret.emplace_back(glm::vec3{c2 * NOTCH_MIN, s2 * NOTCH_MIN, 1}, color);
+    wall.set_gauges(wall_gauges);
   }
+  glClearColor(0.2, 0.2, 0.2, 1.0);
+  if (check_allocations) {
+    // uploading the atlas allocates, get it out of the way
+    gauge.text.finish_loading();
+  }
+  constexpr int STEADY_AFTER = 10;
+  std::uint64_t heap_mark = heapAllocations();
+
+  std::vector<double> frame_ms;
+  frame_ms.reserve(frames);
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; i++) {
+    const auto frame_start = std::chrono::steady_clock::now();
+
+    // sweep the needle across the dial so every frame differs
+    const float t = static_cast<float>(i) / frames;
+    gauge_renderer::frame f{width, height};
+    f.mode = mode;
+    f.rpm = map<float>(std::sin(t * 2.0f * M_PI), -1, 1, RPM_MIN, RPM_MAX);
+    f.hours = t * 100.0f;
 
-  const datapack notch_small[] = {
-      // triangle 1
-      {glm::vec3{NOTCH_MIN, +NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
-      {glm::vec3{NOTCH_MIN, -NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
-      {glm::vec3{NOTCH_MAX_SMALL, +NOTCH_WIDTH / 2, 3},
-       glm::vec3{0.2, 0.2, 0.2}},
-      // triangle 2
-      {glm::vec3{NOTCH_MIN, -NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
-      {glm::vec3{NOTCH_MAX_SMALL, +NOTCH_WIDTH / 2, 3},
-       glm::vec3{0.2, 0.2, 0.2}},
-      {glm::vec3{NOTCH_MAX_SMALL, -NOTCH_WIDTH / 2, 3},
-       glm::vec3{0.2, 0.2, 0.2}},
-  };
-  const datapack notch_large[] = {
-      // triangle 1
-      {glm::vec3{NOTCH_MIN, +NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
-      {glm::vec3{NOTCH_MIN, -NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
-      {glm::vec3{NOTCH_MAX, +NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
-      // triangle 2
-      {glm::vec3{NOTCH_MIN, -NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
-      {glm::vec3{NOTCH_MAX, +NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
-      {glm::vec3{NOTCH_MAX, -NOTCH_WIDTH / 2, 3}, glm::vec3{0.2, 0.2, 0.2}},
-  };
-
-  for (int rpm = RPM_MIN; rpm <= RPM_MAX; rpm += RPM_STEP) {
-    const float i_ = static_cast<float>(rpm) / (NOTCHES - 1);
-    const float angle =
-        glm::radians(map<float>(rpm, RPM_MIN, RPM_MAX, min, max));
-
-    glm::mat4 mat = glm::rotate(glm::identity<glm::mat4>(), angle, {0, 0, 1});
-    const datapack *cbegin, *cend;
-    if (rpm % (RPM_STEP * 5) == 0) {
-      cbegin = std::cbegin(notch_large);
-      cend = std::cend(notch_large);
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (gauges > 0) {
+      // every gauge a little out of phase with its neighbour, the shader
+      // clamps the values to each range
+      for (int g = 0; g < gauges; g++) {
+        wall_values[g] = map<float>(std::sin((t + g * 0.01f) * 2.0f * M_PI),
+                                    -1, 1, RPM_MIN, RPM_MAX);
+      }
+      wall.draw(wall_values, width, height);
     } else {
-      cbegin = std::cbegin(notch_small);
-      cend = std::cend(notch_small);
+      gauge.draw(f);
     }
-    std::transform(cbegin, cend, std::back_inserter(ret), [&](datapack data) {
-      data.pos = mat * glm::vec4(data.pos, 0);
-      return data;
-    });
-  }
+    // wait for the frame to actually be rendered, there is no swap to do it
+    context.finish();
+    if (i == 0) {
+      startup_log::stage("first frame");
+    }
+    if (check_allocations && i >= STEADY_AFTER &&
+        heapAllocations() != heap_mark) {
+      std::fprintf(stderr, "check-allocations: frame %d allocated %llu times\n",
+                   i, static_cast<unsigned long long>(heapAllocations() -
+                                                      heap_mark));
+      std::abort();
+    }
+    heap_mark = heapAllocations();
 
-  for (datapack &vert : ret) {
-    vert.pos *= glm::vec3{DIAMETER, DIAMETER, 1.0};
+    frame_ms.push_back(std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - frame_start)
+                           .count());
   }
+  const double total_s =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  std::printf("renderer: %s\n", glGetString(GL_RENDERER));
+  std::printf("frames:   %d @ %dx%d in %0.3f s (%0.1f FPS)\n", frames, width,
+              height, total_s, frames / total_s);
+  if (gauges > 0) {
+    std::printf("gauges:   %d, %zu draw calls per frame\n", gauges,
+                wall.reset_stats().draw_calls / frames);
+    wall.destroy();
+  }
+  printPercentiles(frame_ms);
 
-  return ret;
-}
-
-static std::vector<datapack> genNeedle() {
-  std::vector<datapack> ret = {
-      // only four verticies are needed since we are using GL_TRIANGLE_STRIP
-      // base
-      {glm::vec3{-NEEDLE_WIDTH / 2, -NEEDLE_OFFSET, 0}, {0.6, 0.4, 0.4}},
-      {glm::vec3{+NEEDLE_WIDTH / 2, -NEEDLE_OFFSET, 0}, {0.6, 0.4, 0.4}},
-      // edge
-      {glm::vec3{-NEEDLE_WIDTH / 2, NEEDLE_LENGTH - NEEDLE_OFFSET, 0},
-       {0.6, 0.2, 0.2}},
-
-      {glm::vec3{+NEEDLE_WIDTH / 2, -NEEDLE_OFFSET, 0}, {0.6, 0.4, 0.4}},
-      {glm::vec3{-NEEDLE_WIDTH / 2, NEEDLE_LENGTH - NEEDLE_OFFSET, 0},
-       {0.6, 0.2, 0.2}},
-
-      {glm::vec3{+NEEDLE_WIDTH / 2, NEEDLE_LENGTH - NEEDLE_OFFSET, 0},
-       {0.6, 0.2, 0.2}},
-  };
-
-  return ret;
-}
-
-static int compileProgram(const char *vert, const char *frag) {
-  GLint success = 0;
-
-  GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vert_shader, 1, &vert, NULL);
-  glCompileShader(vert_shader);
-  glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &success);
-  assert(success);
-
-  GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(frag_shader, 1, &frag, NULL);
-  glCompileShader(frag_shader);
-  glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &success);
-  assert(success);
-
-  GLuint program = glCreateProgram();
-
-  glAttachShader(program, vert_shader);
-  glAttachShader(program, frag_shader);
-  glLinkProgram(program);
-  glDetachShader(program, vert_shader);
-  glDetachShader(program, frag_shader);
-
-  glDeleteShader(vert_shader);
-  glDeleteShader(frag_shader);
-
-  glGetProgramiv(program, GL_LINK_STATUS, (int *)&success);
-  assert(success);
-
-  return program;
+  gauge.destroy();
+  context.destroy();
+  return 0;
 }
 
-static int genShapeRenderingProgram() {
-  static const char *vert = R"GLSL(#version 410 core
-  layout(location=0) in vec2 position;
-  layout(location=1) in vec3 color;
-  
-  uniform mat4 model;
-  uniform mat4 view;
-  
-  out vec3 Color;
-  
-  void main()
-  {
-    gl_Position = (view * model) * vec4(position, 0.0, 1.0);
-    Color = color;
+static void printPercentiles(std::vector<double> samples) {
+  if (samples.empty()) {
+    return;
   }
-  )GLSL";
-
-  static const char *frag = R"GLSL(#version 410 core
-  in vec3 Color;
-  out vec4 outColor;
-  
-  void main()
-  {
-    outColor = vec4(Color, 1.0);
-  }
-  )GLSL";
-  return compileProgram(vert, frag);
+  std::sort(samples.begin(), samples.end());
+  const auto percentile = [&](double p) {
+    return samples[std::min(samples.size() - 1,
+                            static_cast<size_t>(p * samples.size()))];
+  };
+  std::printf("frame ms: min %0.3f  p50 %0.3f  p90 %0.3f  p99 %0.3f  max "
+              "%0.3f\n",
+              samples.front(), percentile(0.50), percentile(0.90),
+              percentile(0.99), samples.back());
 }
 
-static int genVao(std::vector<datapack> const &data) {
-  GLuint vao;
-  glGenVertexArrays(1, &vao);
-  glBindVertexArray(vao);
-  GLuint vbo;
-  glGenBuffers(1, &vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(datapack), data.data(),
-               GL_STATIC_DRAW);
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(datapack),
-                        (void *)offsetof(datapack, pos));
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(datapack),
-                        (void *)offsetof(datapack, color));
-  return vao;
+// Any of these may change what ImGui draws or the size of the framebuffer
+static void watchWindowEvents(GLFWwindow *window) {
+  glfwSetWindowFocusCallback(window,
+                             [](GLFWwindow *, int) { window_event = true; });
+  glfwSetCursorEnterCallback(window,
+                             [](GLFWwindow *, int) { window_event = true; });
+  glfwSetCursorPosCallback(
+      window, [](GLFWwindow *, double, double) { window_event = true; });
+  glfwSetMouseButtonCallback(
+      window, [](GLFWwindow *, int, int, int) { window_event = true; });
+  glfwSetScrollCallback(
+      window, [](GLFWwindow *, double, double) { window_event = true; });
+  glfwSetKeyCallback(window, [](GLFWwindow *, int, int, int, int) {
+    window_event = true;
+  });
+  glfwSetCharCallback(window,
+                      [](GLFWwindow *, unsigned int) { window_event = true; });
+  glfwSetFramebufferSizeCallback(
+      window, [](GLFWwindow *, int, int) { window_event = true; });
+  glfwSetWindowRefreshCallback(window,
+                               [](GLFWwindow *) { window_event = true; });
 }
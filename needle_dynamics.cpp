@@ -0,0 +1,56 @@
+#include "needle_dynamics.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numbers>
+
+static constexpr std::chrono::nanoseconds MAX_ADVANCE =
+    std::chrono::milliseconds(250);
+
+void needle_dynamics::configure(params const &p) {
+  assert(p.step > 0 && p.time_constant > 0 && p.frequency_hz > 0);
+  config = p;
+  step_length = std::chrono::round<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(p.step));
+  assert(step_length.count() > 0);
+}
+
+void needle_dynamics::reset(float rpm) {
+  previous = now = {rpm, 0};
+  accumulator = {};
+}
+
+int needle_dynamics::advance(float target, std::chrono::nanoseconds dt) {
+  accumulator += std::min(dt, MAX_ADVANCE);
+  int steps = 0;
+  while (accumulator >= step_length) {
+    previous = now;
+    now = step(config, now, target);
+    accumulator -= step_length;
+    steps++;
+  }
+  return steps;
+}
+
+float needle_dynamics::interpolated() const {
+  const float t = float(accumulator.count()) / step_length.count();
+  return previous.rpm + (now.rpm - previous.rpm) * t;
+}
+
+needle_dynamics::state needle_dynamics::step(params const &p, state s,
+                                             float target) {
+  if (p.kind == model::lag) {
+    // exact discretization of d(rpm)/dt = (target - rpm) / time_constant
+    const float k = 1.0f - std::exp(-p.step / p.time_constant);
+    return {s.rpm + (target - s.rpm) * k, (target - s.rpm) * k / p.step};
+  }
+
+  // semi-implicit Euler, stable as long as step * omega stays well below 2
+  const float omega = 2.0f * std::numbers::pi_v<float> * p.frequency_hz;
+  const float acceleration = omega * omega * (target - s.rpm) -
+                             2.0f * p.damping * omega * s.velocity;
+  s.velocity += acceleration * p.step;
+  s.rpm += s.velocity * p.step;
+  return s;
+}
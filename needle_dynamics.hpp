@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+
+// Moves the needle towards the latest reading like a physical gauge would,
+// instead of jumping straight to it.
+//
+// The model is integrated at a fixed timestep no matter how often advance()
+// is called, so the motion (and its cost) is the same at any display refresh
+// rate and for a given sequence of targets is bit-for-bit reproducible. The
+// renderer draws interpolated(), a blend of the last two physics states, so
+// the needle stays smooth when the frame rate is not a multiple of the step
+// rate.
+class needle_dynamics {
+public:
+  enum class model {
+    spring, // damped mass-spring, can overshoot when damping < 1
+    lag,    // first order low pass, approaches the target exponentially
+  };
+
+  struct params {
+    model kind{model::spring};
+    float frequency_hz{3.0f};   // spring: undamped natural frequency
+    float damping{0.7f};        // spring: damping ratio, 1 is critical
+    float time_constant{0.08f}; // lag: seconds to cover 63% of a step
+    float step{1.0f / 240.0f};  // fixed timestep, seconds
+  };
+
+  struct state {
+    float rpm{0};
+    float velocity{0}; // rpm per second
+  };
+
+  needle_dynamics() { configure({}); }
+  void configure(params const &p);
+  params const &parameters() const { return config; }
+  // Puts the needle at rest on `rpm`
+  void reset(float rpm);
+
+  // Runs as many fixed steps towards `target` as fit in `dt` of wall time
+  // plus what was left over last time, returns how many were run. At most a
+  // quarter second is simulated per call, time beyond that (i.e. the window
+  // was dragged) is dropped rather than caught up on.
+  int advance(float target, std::chrono::nanoseconds dt);
+
+  // The rpm to draw, between the previous and the current step
+  float interpolated() const;
+  state const &current() const { return now; }
+
+  // One fixed step of the model from `s` towards `target`
+  static state step(params const &p, state s, float target);
+
+private:
+  params config;
+  state previous, now;
+  // kept in whole nanoseconds so that the same wall time runs the same steps
+  // however it was split into frames
+  std::chrono::nanoseconds step_length{0};
+  std::chrono::nanoseconds accumulator{0};
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Compact vertex for the dial and needle: snorm16 xy position and an RGBA8
+// color, 8 bytes instead of the 24 of datapack. The layer tag datapack keeps
+// in pos.z is never read by the shader and is dropped.
+struct packed_vertex {
+  std::int16_t x, y;
+  std::uint8_t r, g, b, a;
+
+  constexpr bool operator==(packed_vertex const &) const = default;
+};
+static_assert(sizeof(packed_vertex) == 8);
+
+struct packed_mesh {
+  std::vector<packed_vertex> vertices;
+  std::vector<std::uint16_t> indices;
+};
+
+namespace packed {
+constexpr std::int16_t snorm16(float v) {
+  v = v < -1 ? -1 : (v > 1 ? 1 : v);
+  const float scaled = v * 32767.0f;
+  return static_cast<std::int16_t>(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+constexpr std::uint8_t unorm8(float v) {
+  v = v < 0 ? 0 : (v > 1 ? 1 : v);
+  return static_cast<std::uint8_t>(v * 255.0f + 0.5f);
+}
+
+constexpr packed_vertex pack(float x, float y, float r, float g, float b) {
+  return {snorm16(x), snorm16(y), unorm8(r), unorm8(g), unorm8(b), 255};
+}
+
+// Writes each distinct vertex of `in` once to `vertices` and one index per
+// input vertex to `indices`, returns how many distinct vertices there are.
+// Quadratic, meant for the few hundred vertices of a gauge.
+constexpr std::size_t index_vertices(std::span<const packed_vertex> in,
+                                     packed_vertex *vertices,
+                                     std::uint16_t *indices) {
+  std::size_t unique = 0;
+  for (std::size_t i = 0; i < in.size(); i++) {
+    std::size_t found = 0;
+    while (found < unique && !(vertices[found] == in[i])) {
+      found++;
+    }
+    if (found == unique) {
+      vertices[unique++] = in[i];
+    }
+    indices[i] = static_cast<std::uint16_t>(found);
+  }
+  return unique;
+}
+} // namespace packed
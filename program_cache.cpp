@@ -0,0 +1,197 @@
+#include "program_cache.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+#include "hash.hpp"
+
+namespace {
+constexpr std::uint32_t MAGIC = 0x42505347; // "GSPB"
+
+// What precedes the binary in every cache file
+struct entry_header {
+  std::uint32_t magic;
+  std::uint32_t format; // as returned by glGetProgramBinary
+  std::uint64_t key;    // same as the file name, guards against renames
+  std::uint64_t length;
+};
+
+std::string_view glString(GLenum name) {
+  const GLubyte *str = glGetString(name);
+  return str ? reinterpret_cast<const char *>(str) : "";
+}
+} // namespace
+
+program_cache &program_cache::current() {
+  static program_cache cache;
+  return cache;
+}
+
+std::string program_cache::default_path() {
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+    return std::string{xdg} + "/rpm_gauge";
+  }
+  if (const char *home = std::getenv("HOME"); home && *home) {
+    return std::string{home} + "/.cache/rpm_gauge";
+  }
+  return {};
+}
+
+bool program_cache::open(std::string path) {
+  close();
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats == 0) {
+    std::fprintf(stderr, "program_cache: driver has no binary formats\n");
+    return false;
+  }
+
+  std::error_code error;
+  if (path.empty() || (!std::filesystem::create_directories(path, error) &&
+                       error)) {
+    std::fprintf(stderr, "program_cache: cannot use '%s': %s\n", path.c_str(),
+                 error.message().c_str());
+    return false;
+  }
+
+  driver_hash = hash64(glString(GL_VENDOR));
+  driver_hash = hash64(glString(GL_RENDERER), driver_hash);
+  driver_hash = hash64(glString(GL_VERSION), driver_hash);
+  directory = std::move(path);
+  return true;
+}
+
+GLuint program_cache::load(const char *vert, const char *frag) {
+  const auto start = std::chrono::steady_clock::now();
+  if (!is_open()) {
+    const GLuint program = compileProgramSource(vert, frag);
+    counters.time += std::chrono::steady_clock::now() - start;
+    return program;
+  }
+
+  std::uint64_t key = hash64(vert, driver_hash);
+  // the separator keeps "ab" + "c" and "a" + "bc" apart
+  key = hash64(std::string_view{"\0", 1}, key);
+  key = hash64(frag, key);
+
+  GLuint program = glCreateProgram();
+  if (read(key, program)) {
+    counters.hits++;
+  } else {
+    glDeleteProgram(program);
+    program = compileProgramSource(vert, frag, true);
+    write(key, program);
+  }
+  counters.time += std::chrono::steady_clock::now() - start;
+  return program;
+}
+
+std::string program_cache::entry_path(std::uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "/%016llx.bin",
+                static_cast<unsigned long long>(key));
+  return directory + name;
+}
+
+bool program_cache::read(std::uint64_t key, GLuint program) {
+  const std::string path = entry_path(key);
+  std::FILE *file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    counters.misses++;
+    return false;
+  }
+
+  entry_header header{};
+  std::vector<char> binary;
+  bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+            header.magic == MAGIC && header.key == key &&
+            header.length < (64u << 20);
+  if (ok) {
+    binary.resize(header.length);
+    ok = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+  }
+  std::fclose(file);
+
+  GLint linked = GL_FALSE;
+  if (ok) {
+    glProgramBinary(program, header.format, binary.data(),
+                    static_cast<GLsizei>(binary.size()));
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  }
+  if (linked != GL_TRUE) {
+    std::fprintf(stderr, "program_cache: rejected %s, recompiling\n",
+                 path.c_str());
+    counters.rejected++;
+    return false;
+  }
+  return true;
+}
+
+void program_cache::write(std::uint64_t key, GLuint program) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+
+  // write next to the entry and rename over it, so a concurrent start never
+  // reads half a file
+  const std::string path = entry_path(key);
+  const std::string temp = path + ".tmp";
+  std::FILE *file = std::fopen(temp.c_str(), "wb");
+  if (!file) {
+    return;
+  }
+  const entry_header header{MAGIC, format, key,
+                            static_cast<std::uint64_t>(length)};
+  const bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  std::fwrite(binary.data(), 1, length, file) ==
+                      static_cast<std::size_t>(length);
+  if (std::fclose(file) != 0 || !ok ||
+      std::rename(temp.c_str(), path.c_str()) != 0) {
+    std::remove(temp.c_str());
+  }
+}
+
+GLuint compileProgramSource(const char *vert, const char *frag,
+                            bool retrievable) {
+  GLint success = 0;
+
+  GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vert_shader, 1, &vert, NULL);
+  glCompileShader(vert_shader);
+  glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &success);
+  assert(success);
+
+  GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(frag_shader, 1, &frag, NULL);
+  glCompileShader(frag_shader);
+  glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &success);
+  assert(success);
+
+  GLuint program = glCreateProgram();
+  if (retrievable) {
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+
+  glAttachShader(program, vert_shader);
+  glAttachShader(program, frag_shader);
+  glLinkProgram(program);
+  glDetachShader(program, vert_shader);
+  glDetachShader(program, frag_shader);
+
+  glDeleteShader(vert_shader);
+  glDeleteShader(frag_shader);
+
+  glGetProgramiv(program, GL_LINK_STATUS, (int *)&success);
+  assert(success);
+
+  return program;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Linked program binaries (glGetProgramBinary) kept on disk, so later runs
+// skip compiling and linking GLSL, which is slow on software renderers.
+//
+// Entries are keyed by a hash of the shader sources and the GL vendor,
+// renderer and version strings, so editing a shader or switching drivers
+// simply misses. A binary the driver rejects anyway (i.e. after a driver
+// update that kept the version string) is recompiled and replaced.
+class program_cache {
+public:
+  struct stats {
+    std::size_t hits{0};
+    std::size_t misses{0};   // not on disk, compiled
+    std::size_t rejected{0}; // on disk, but the driver refused it
+    std::chrono::nanoseconds time{0};
+  };
+
+  // There is exactly one GL context, so exactly one cache
+  static program_cache &current();
+
+  // Enables the cache in `path`, creating the directory if needed. Returns
+  // false (and stays disabled) when it cannot be created or the driver
+  // supports no binary formats. Needs a current GL context.
+  bool open(std::string path);
+  void close() { directory.clear(); }
+  bool is_open() const { return !directory.empty(); }
+  // $XDG_CACHE_HOME/rpm_gauge, or ~/.cache/rpm_gauge
+  static std::string default_path();
+
+  // Links `vert` and `frag`, loading the binary from the cache when there is
+  // one and storing it otherwise. Without an open cache this just compiles.
+  GLuint load(const char *vert, const char *frag);
+
+  stats const &totals() const { return counters; }
+
+private:
+  std::string directory;
+  std::uint64_t driver_hash{0};
+  stats counters;
+
+  std::string entry_path(std::uint64_t key) const;
+  bool read(std::uint64_t key, GLuint program);
+  void write(std::uint64_t key, GLuint program);
+};
+
+// Compiles and links from source, asserting on errors. With `retrievable`
+// the driver is asked to keep the binary around for glGetProgramBinary.
+GLuint compileProgramSource(const char *vert, const char *frag,
+                            bool retrievable = false);
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstddef>
+
+// Shadow copy of the bits of GL state main.cpp, Program and text_renderer
+// touch, so binds can be skipped when they would not change anything and the
+// current values never have to be read back with glGetIntegerv.
+//
+// Everything in this program that binds a program, VAO, array buffer, 2D
+// texture or changes blending or the unpack alignment must go through here.
+// Code that changes this state behind our back (i.e. a third party renderer
+// that does not restore what it touched) has to call invalidate() afterwards.
+class render_state {
+public:
+  struct stats {
+    std::size_t issued{0};  // GL calls that reached the driver
+    std::size_t avoided{0}; // redundant GL calls that were skipped
+  };
+
+  // There is exactly one GL context, so exactly one shadow copy
+  static render_state &current() {
+    static render_state state;
+    return state;
+  }
+
+  void use_program(GLuint id) {
+    if (update(program, id)) {
+      glUseProgram(id);
+    }
+  }
+  void bind_vertex_array(GLuint id) {
+    if (update(vertex_array, id)) {
+      glBindVertexArray(id);
+    }
+  }
+  void bind_array_buffer(GLuint id) {
+    if (update(array_buffer, id)) {
+      glBindBuffer(GL_ARRAY_BUFFER, id);
+    }
+  }
+  void bind_texture_2d(GLuint id) {
+    if (update(texture_2d, id)) {
+      glBindTexture(GL_TEXTURE_2D, id);
+    }
+  }
+  void set_blend(bool enabled) {
+    if (update(blend, enabled ? 1 : 0)) {
+      enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+    }
+  }
+  // Uploads set the alignment they need rather than restore the previous one
+  void set_unpack_alignment(GLint alignment) {
+    if (update(unpack_alignment, static_cast<GLuint>(alignment))) {
+      glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    }
+  }
+  void blend_func(GLenum src, GLenum dst) {
+    if (blend_src == src && blend_dst == dst) {
+      frame_stats.avoided++;
+      return;
+    }
+    blend_src = src;
+    blend_dst = dst;
+    frame_stats.issued++;
+    glBlendFunc(src, dst);
+  }
+
+  // Deleting a bound object reverts the binding to 0, keep the shadow in sync.
+  // A deleted program stays current until replaced, so just forget it.
+  void delete_program(GLuint id) {
+    if (program == id) {
+      program = UNKNOWN;
+    }
+    glDeleteProgram(id);
+  }
+  void delete_vertex_array(GLuint id) {
+    if (vertex_array == id) {
+      vertex_array = 0;
+    }
+    glDeleteVertexArrays(1, &id);
+  }
+  void delete_buffer(GLuint id) {
+    if (array_buffer == id) {
+      array_buffer = 0;
+    }
+    glDeleteBuffers(1, &id);
+  }
+  void delete_texture(GLuint id) {
+    if (texture_2d == id) {
+      texture_2d = 0;
+    }
+    glDeleteTextures(1, &id);
+  }
+
+  // Forget everything, the next call for each piece of state goes through
+  void invalidate() {
+    program = UNKNOWN;
+    vertex_array = UNKNOWN;
+    array_buffer = UNKNOWN;
+    texture_2d = UNKNOWN;
+    blend = UNKNOWN;
+    blend_src = UNKNOWN;
+    blend_dst = UNKNOWN;
+    unpack_alignment = UNKNOWN;
+  }
+
+  // counters accumulated since the previous call
+  stats reset_stats() {
+    stats ret = frame_stats;
+    frame_stats = {};
+    return ret;
+  }
+
+private:
+  static constexpr GLuint UNKNOWN = ~GLuint{0};
+
+  GLuint program{UNKNOWN};
+  GLuint vertex_array{UNKNOWN};
+  GLuint array_buffer{UNKNOWN};
+  GLuint texture_2d{UNKNOWN};
+  GLuint blend{UNKNOWN};
+  GLuint blend_src{UNKNOWN};
+  GLuint blend_dst{UNKNOWN};
+  GLuint unpack_alignment{UNKNOWN};
+  stats frame_stats;
+
+  bool update(GLuint &shadow, GLuint value) {
+    if (shadow == value) {
+      frame_stats.avoided++;
+      return false;
+    }
+    shadow = value;
+    frame_stats.issued++;
+    return true;
+  }
+};
@@ -0,0 +1,160 @@
+#include "render_thread.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include "imgui_impl_opengl3.h"
+#include "program_cache.hpp"
+#include "startup_log.hpp"
+
+ui_draw_data::~ui_draw_data() {
+  for (ImDrawList *list : lists) {
+    IM_DELETE(list);
+  }
+}
+
+void ui_draw_data::copy(ImDrawData const &source) {
+  while (lists.size() < static_cast<std::size_t>(source.CmdListsCount)) {
+    lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+  }
+
+  // resize() keeps the capacity a list already has, assigning an ImVector
+  // would free and reallocate it every time
+  const auto copy_vector = [](auto &to, auto const &from) {
+    to.resize(from.Size);
+    if (from.Size > 0) {
+      std::memcpy(to.Data, from.Data, from.size_in_bytes());
+    }
+  };
+
+  data.Valid = source.Valid;
+  data.CmdLists.resize(0);
+  for (int i = 0; i < source.CmdListsCount; i++) {
+    ImDrawList const &from = *source.CmdLists[i];
+    ImDrawList &to = *lists[i];
+    copy_vector(to.CmdBuffer, from.CmdBuffer);
+    copy_vector(to.IdxBuffer, from.IdxBuffer);
+    copy_vector(to.VtxBuffer, from.VtxBuffer);
+    to.Flags = from.Flags;
+    data.CmdLists.push_back(&to);
+  }
+  data.CmdListsCount = source.CmdListsCount;
+  data.TotalIdxCount = source.TotalIdxCount;
+  data.TotalVtxCount = source.TotalVtxCount;
+  data.DisplayPos = source.DisplayPos;
+  data.DisplaySize = source.DisplaySize;
+  data.FramebufferScale = source.FramebufferScale;
+  data.OwnerViewport = source.OwnerViewport;
+}
+
+void render_thread::start(GLFWwindow *w, glyph_format glyphs) {
+  window = w;
+  text_format = glyphs;
+  quit = false;
+  ready = false;
+  // a context can only be current on one thread at a time
+  glfwMakeContextCurrent(nullptr);
+  thread = std::thread([this] { run(); });
+  ready.wait(false);
+}
+
+void render_thread::stop() {
+  if (!thread.joinable()) {
+    return;
+  }
+  quit = true;
+  wake();
+  thread.join();
+  glfwMakeContextCurrent(window);
+}
+
+void render_thread::publish() {
+  frames.publish();
+  wake();
+}
+
+void render_thread::set_continuous(bool enabled) {
+  if (continuous.exchange(enabled) != enabled) {
+    // wake it up to notice
+    wake();
+  }
+}
+
+void render_thread::wake() {
+  published.fetch_add(1, std::memory_order_release);
+  published.notify_one();
+}
+
+void render_thread::run() {
+  glfwMakeContextCurrent(window);
+  // GL function pointers were loaded on the main thread, they are the same
+  // for every thread the context is made current on
+  ImGui_ImplOpenGL3_Init("#version 410 core");
+  // creates the shaders and uploads the font atlas, so ImGui::NewFrame() on
+  // the logic thread finds it built
+  ImGui_ImplOpenGL3_NewFrame();
+  startup_log::stage("imgui renderer");
+
+  gauge_renderer gauge;
+  // redraws the latest snapshot, now with labels, once the atlas is loaded
+  gauge.allocate(text_format, [this] { wake(); });
+  const program_cache::stats programs = program_cache::current().totals();
+  std::fprintf(stderr,
+               "startup: programs: %zu cached, %zu compiled, %zu rejected in "
+               "%0.2f ms\n",
+               programs.hits, programs.misses, programs.rejected,
+               std::chrono::duration<float, std::milli>(programs.time).count());
+  render_state &state = render_state::current();
+  state.invalidate();
+
+  ready = true;
+  ready.notify_one();
+
+  std::uint64_t drawn = 0;
+  stats frame_stats;
+  while (true) {
+    const std::uint64_t seen = published.load(std::memory_order_acquire);
+    if (seen == drawn && !continuous.load(std::memory_order_relaxed)) {
+      published.wait(seen);
+      continue;
+    }
+    drawn = seen;
+    if (quit.load(std::memory_order_relaxed)) {
+      break;
+    }
+    frames.update();
+    snapshot &s = frames.front();
+    if (s.gauge.width == 0) {
+      continue; // nothing published yet
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    glViewport(0, 0, s.gauge.width, s.gauge.height);
+    glClearColor(s.gauge.theme.background.r, s.gauge.theme.background.g,
+                 s.gauge.theme.background.b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glPolygonMode(GL_FRONT_AND_BACK, s.wireframe ? GL_LINE : GL_FILL);
+    gauge.draw(s.gauge);
+
+    // the ImGui backend restores every piece of state it changes, so the
+    // shadow copy in render_state stays valid across it
+    ImGui_ImplOpenGL3_RenderDrawData(s.ui.get());
+
+    frame_stats.text = gauge.text.reset_stats();
+    frame_stats.text_loaded = gauge.text.poll_loaded();
+    frame_stats.state = state.reset_stats();
+    frame_stats.cache = gauge.cache_stats();
+    frame_stats.frame_time = std::chrono::steady_clock::now() - start;
+    frame_stats.frames++;
+    shared_stats.store(frame_stats);
+
+    glfwSwapBuffers(window);
+    if (frame_stats.frames == 1) {
+      startup_log::stage("first frame");
+    }
+  }
+
+  gauge.destroy();
+  ImGui_ImplOpenGL3_Shutdown();
+  glfwMakeContextCurrent(nullptr);
+}
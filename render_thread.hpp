@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gauge.hpp"
+#include "imgui.h"
+#include "render_state.hpp"
+#include "seqlock.hpp"
+#include "text_renderer.hpp"
+#include "triple_buffer.hpp"
+
+// A copy of ImGui's draw data that outlives the next ImGui::NewFrame(), so
+// the UI can be built on one thread and drawn on another. Keeps its draw
+// lists from frame to frame, copying into them does not allocate once they
+// are big enough.
+class ui_draw_data {
+public:
+  ui_draw_data() = default;
+  ui_draw_data(ui_draw_data const &) = delete;
+  ui_draw_data &operator=(ui_draw_data const &) = delete;
+  ~ui_draw_data();
+
+  void copy(ImDrawData const &source);
+  ImDrawData *get() { return &data; }
+
+private:
+  ImDrawData data;
+  std::vector<ImDrawList *> lists;
+};
+
+// Owns the GL context: everything that talks to GL (the gauge, the ImGui
+// renderer backend, buffer swaps) runs on this thread, drawing immutable
+// snapshots the logic thread publishes through a triple buffer. A slow UI
+// frame or a burst of telemetry on the logic thread can then no longer hold
+// up a frame, and the logic thread runs at whatever rate it likes.
+class render_thread {
+public:
+  // Everything one frame shows
+  struct snapshot {
+    gauge_renderer::frame gauge{0, 0};
+    bool wireframe{false};
+    ui_draw_data ui;
+  };
+
+  struct stats {
+    text_renderer::stats text;
+    render_state::stats state;
+    gauge_renderer::stats cache;
+    std::chrono::nanoseconds frame_time{0}; // submission, without the swap
+    std::uint64_t frames{0};
+    bool text_loaded{false}; // the glyph atlas is uploaded
+  };
+
+  // Takes the window's context over from the calling thread and returns once
+  // the renderers are set up, ImGui::NewFrame() may be called after that.
+  // ImGui's context has to exist already.
+  void start(GLFWwindow *window,
+             glyph_format text_format = glyph_format::coverage);
+  // Finishes the frame in flight and hands the context back
+  void stop();
+
+  // Logic thread: fill in back() completely, then publish() it
+  snapshot &back() { return frames.back(); }
+  void publish();
+
+  // Without new snapshots the thread sleeps, unless continuous, where it
+  // redraws the latest one every swap interval
+  void set_continuous(bool enabled);
+
+  // Latest figures, false if no frame has been drawn yet
+  bool latest_stats(stats &out) const {
+    return shared_stats.version() > 0 && shared_stats.load(out);
+  }
+
+private:
+  GLFWwindow *window{nullptr};
+  glyph_format text_format{glyph_format::coverage};
+  std::thread thread;
+  triple_buffer<snapshot> frames;
+  std::atomic<std::uint64_t> published{0};
+  std::atomic<bool> continuous{false};
+  std::atomic<bool> quit{false};
+  std::atomic<bool> ready{false}; // set up, start() may return
+  seqlock<stats> shared_stats;
+
+  // makes the thread look at the latest snapshot again
+  void wake();
+  void run();
+};
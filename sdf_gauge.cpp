@@ -0,0 +1,165 @@
+#include "sdf_gauge.hpp"
+
+#include <cstddef>
+
+#include "gauge.hpp"
+#include "render_state.hpp"
+
+static constexpr GLuint UNIFORM_BINDING = 0;
+
+static const char *vert = R"GLSL(#version 410 core
+layout(std140) uniform gauge_block {
+  vec4 view;
+  vec4 sweep;
+  vec4 radii;
+  vec4 needle;
+  vec4 limits;
+  vec4 yellow;
+  vec4 green;
+  vec4 red;
+};
+
+out vec2 Position;
+
+void main()
+{
+  // triangle strip over the dial plus a little room for the AA fringe
+  vec2 corner = vec2((gl_VertexID & 1) == 0 ? -1.0 : 1.0,
+                     (gl_VertexID & 2) == 0 ? -1.0 : 1.0);
+  Position = corner * needle.w * 1.02;
+  gl_Position = vec4(Position * view.xy, 0.0, 1.0);
+}
+)GLSL";
+
+static const char *frag = R"GLSL(#version 410 core
+layout(std140) uniform gauge_block {
+  vec4 view;
+  vec4 sweep;
+  vec4 radii;
+  vec4 needle;
+  vec4 limits;
+  vec4 yellow;
+  vec4 green;
+  vec4 red;
+};
+
+in vec2 Position; // gauge space, same as the needle mesh
+out vec4 outColor;
+
+// signed distance to pixel coverage, one pixel wide ramp
+float coverage(float d)
+{
+  return clamp(0.5 - d / max(fwidth(d), 1e-6), 0.0, 1.0);
+}
+
+void main()
+{
+  vec2 p = Position / needle.w; // dial space, rim at 1
+  float r = length(p);
+
+  // the sweep runs clockwise from sweep.x down to sweep.y, through the top
+  float theta = degrees(atan(p.y, p.x));
+  if (theta < sweep.y - 45.0) {
+    theta += 360.0;
+  }
+  float deg_per_rpm = (sweep.y - sweep.x) / sweep.z;
+  float rpm = (theta - sweep.x) / deg_per_rpm;
+
+  vec3 color = vec3(0.7);
+  float alpha = coverage(r - 1.0);
+
+  // color bands, an annulus clipped to the sweep
+  float band_rpm = floor(clamp(rpm, 0.0, sweep.z - 1.0) / sweep.w) * sweep.w;
+  vec3 band = green.rgb;
+  if (band_rpm < limits.x || (band_rpm >= limits.y && band_rpm < limits.z)) {
+    band = yellow.rgb;
+  } else if (band_rpm >= limits.z) {
+    band = red.rgb;
+  }
+  float d_ring = max(radii.x - r, r - radii.y);
+  float d_sweep = radians(max(-rpm, rpm - sweep.z) * abs(deg_per_rpm)) * r;
+  color = mix(color, band, coverage(max(d_ring, d_sweep)));
+
+  // nearest notch, a thin box along its ray
+  float k = clamp(round(rpm / sweep.w), 0.0, sweep.z / sweep.w);
+  float notch_theta = radians(sweep.x + k * sweep.w * deg_per_rpm);
+  vec2 dir = vec2(cos(notch_theta), sin(notch_theta));
+  float along = dot(p, dir);
+  float across = abs(dot(p, vec2(-dir.y, dir.x)));
+  float outer = mod(k, limits.w) == 0.0 ? radii.z : radii.y;
+  float d_notch = max(across - radii.w * 0.5,
+                      max(radii.x - along, along - outer));
+  color = mix(color, vec3(0.2), coverage(d_notch));
+
+  // needle, undo its clockwise rotation and test against a box
+  float a = view.z;
+  vec2 q = mat2(cos(a), sin(a), -sin(a), cos(a)) * Position;
+  vec2 half_size = needle.xy * 0.5;
+  vec2 center = vec2(0.0, half_size.y - needle.z);
+  vec2 d_box = abs(q - center) - half_size;
+  float d_needle = length(max(d_box, 0.0)) + min(max(d_box.x, d_box.y), 0.0);
+  float t = clamp((q.y + needle.z) / needle.y, 0.0, 1.0);
+  float needle_coverage = coverage(d_needle);
+  color = mix(color, mix(vec3(0.6, 0.4, 0.4), vec3(0.6, 0.2, 0.2), t),
+              needle_coverage);
+
+  outColor = vec4(color, max(alpha, needle_coverage));
+}
+)GLSL";
+
+void sdf_gauge::allocate() {
+  program = compileProgram(vert, frag);
+  // no vertex data, the quad comes from gl_VertexID, but core profile still
+  // wants a VAO bound to draw
+  glGenVertexArrays(1, &vao);
+
+  const GLuint program_id = program.id();
+  glUniformBlockBinding(program_id,
+                        glGetUniformBlockIndex(program_id, "gauge_block"),
+                        UNIFORM_BINDING);
+
+  constexpr float min = 90.0f + (NEEDLE_RANGE / 2.0f);
+  constexpr float max = 90.0f - (NEEDLE_RANGE / 2.0f);
+  const uniforms data{
+      {1, 1, 0, 0},
+      {min, max, RPM_MAX, RPM_STEP},
+      {NOTCH_MIN, NOTCH_MAX_SMALL, NOTCH_MAX, NOTCH_WIDTH},
+      {NEEDLE_WIDTH, NEEDLE_LENGTH, NEEDLE_OFFSET, DIAMETER},
+      // same thresholds genCompleteBase() colors the bands with
+      {500, 2600, 2800, 5},
+      glm::vec4{Hue(60), 1},
+      glm::vec4{Hue(140), 1},
+      glm::vec4{Hue(0), 1},
+  };
+  glGenBuffers(1, &ubo);
+  glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(data), &data, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  last_view = data.view;
+}
+
+void sdf_gauge::destroy() {
+  render_state &state = render_state::current();
+  state.delete_vertex_array(vao);
+  glDeleteBuffers(1, &ubo);
+  program.delete_();
+}
+
+void sdf_gauge::draw(glm::vec2 view, float needle_angle) {
+  render_state &state = render_state::current();
+
+  // only the first vec4 changes from frame to frame
+  const glm::vec4 frame_view{view, glm::radians(needle_angle), 0};
+  glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BINDING, ubo);
+  if (frame_view != last_view) {
+    glBufferSubData(GL_UNIFORM_BUFFER, offsetof(uniforms, view),
+                    sizeof(frame_view), &frame_view);
+    last_view = frame_view;
+  }
+
+  state.set_blend(true);
+  state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  program.use();
+  state.bind_vertex_array(vao);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
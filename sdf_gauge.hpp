@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+
+// Draws the dial, color bands, notches and needle analytically: one quad
+// over the dial and a fragment shader evaluating signed distance functions
+// for every shape. Edges are anti-aliased at any resolution without MSAA and
+// there is no tessellated geometry at all.
+class sdf_gauge {
+public:
+  void allocate();
+  void destroy();
+
+  // `view` scales gauge space to NDC, as the mesh path's view matrix does
+  void draw(glm::vec2 view, float needle_angle);
+
+private:
+  // std140 layout of the gauge_block uniform block
+  struct uniforms {
+    glm::vec4 view;   // xy: view scale, z: needle angle (radians)
+    glm::vec4 sweep;  // x/y: angle of RPM_MIN/RPM_MAX (degrees), z: RPM_MAX,
+                      // w: RPM_STEP
+    glm::vec4 radii;  // NOTCH_MIN, NOTCH_MAX_SMALL, NOTCH_MAX, NOTCH_WIDTH
+    glm::vec4 needle; // NEEDLE_WIDTH, NEEDLE_LENGTH, NEEDLE_OFFSET, DIAMETER
+    glm::vec4 limits; // band color thresholds in rpm, w: steps per big notch
+    glm::vec4 yellow, green, red;
+  };
+
+  Program program;
+  GLuint vao, ubo;
+  glm::vec4 last_view{0};
+};
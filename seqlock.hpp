@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer "latest value" cell protected by a sequence lock.
+//
+// The writer never waits on readers; readers retry if a write was in flight
+// and therefore never observe a torn value. The payload is stored as relaxed
+// atomic words so concurrent access stays well defined, and the whole object
+// is address-free, so it can live in memory shared between processes.
+template <typename T> class seqlock {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                "shared memory needs address-free atomics");
+
+public:
+  void store(T const &value) {
+    std::uint64_t words[WORDS] = {};
+    std::memcpy(words, &value, sizeof(T));
+
+    const std::uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed); // odd: write begins
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < WORDS; i++) {
+      data[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence.store(seq + 2, std::memory_order_release); // even: write done
+  }
+
+  // Returns false if no consistent snapshot was seen within `max_retries`,
+  // i.e. a writer died halfway through an update
+  bool load(T &value, int max_retries = 1000) const {
+    for (int attempt = 0; attempt < max_retries; attempt++) {
+      const std::uint32_t begin = sequence.load(std::memory_order_acquire);
+      if (begin & 1) {
+        continue;
+      }
+      std::uint64_t words[WORDS];
+      for (std::size_t i = 0; i < WORDS; i++) {
+        words[i] = data[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence.load(std::memory_order_relaxed) == begin) {
+        std::memcpy(&value, words, sizeof(T));
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Number of completed writes, cheap way to tell whether anything changed
+  std::uint32_t version() const {
+    return sequence.load(std::memory_order_acquire) / 2;
+  }
+
+private:
+  static constexpr std::size_t WORDS =
+      (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  std::atomic<std::uint32_t> sequence{0};
+  std::atomic<std::uint64_t> data[WORDS] = {};
+};
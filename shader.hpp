@@ -4,86 +4,159 @@
 #include <glm/ext.hpp>
 #include <glm/glm.hpp>
 
+#include "render_state.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
 namespace impl {
+// FNV-1a, constexpr so uniform names written as literals hash at compile time
+constexpr std::uint32_t hash(std::string_view str) {
+  std::uint32_t ret = 2166136261u;
+  for (char c : str) {
+    ret ^= static_cast<unsigned char>(c);
+    ret *= 16777619u;
+  }
+  return ret;
+}
+
+// Only constructible from a constant expression, so every setUniform("name")
+// call site pays for the hash once during compilation
+struct uniform_name {
+  std::uint32_t hash;
+  consteval uniform_name(const char *name) : hash(impl::hash(name)) {}
+};
+
 struct Program {
   GLuint program_id{0};
 
-  static Program getCurrentProgram() {
-    GLuint program_id;
-    glGetIntegerv(GL_CURRENT_PROGRAM, (GLint *)&program_id);
-    return Program{program_id};
-  }
-
-  void useProgram() { glUseProgram(program_id); }
-  GLuint getUniformLocation(const char *name) {
+  // glProgramUniform* (GL 4.1) writes straight into the program object, no
+  // need to bind it and restore the previous program around every update
+  void useProgram() { render_state::current().use_program(program_id); }
+  GLint getUniformLocation(const char *name) {
     return glGetUniformLocation(program_id, name);
   }
 
   void uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose,
                         const GLfloat *value) {
-    Program prev = Program::getCurrentProgram();
-    useProgram();
-    glUniformMatrix3fv(location, count, transpose, value);
-    prev.useProgram();
+    glProgramUniformMatrix3fv(program_id, location, count, transpose, value);
   }
   void uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose,
                         const GLfloat *value) {
-    Program prev = Program::getCurrentProgram();
-    useProgram();
-    glUniformMatrix4fv(location, count, transpose, value);
-    prev.useProgram();
+    glProgramUniformMatrix4fv(program_id, location, count, transpose, value);
+  }
+  void uniform1f(GLint location, const GLfloat value) {
+    glProgramUniform1f(program_id, location, value);
+  }
+  void uniform2fv(GLint location, GLsizei count, const GLfloat *value) {
+    glProgramUniform2fv(program_id, location, count, value);
   }
   void uniform3fv(GLint location, GLsizei count, const GLfloat *value) {
-    Program prev = Program::getCurrentProgram();
-    useProgram();
-    glUniform3fv(location, count, value);
-    prev.useProgram();
+    glProgramUniform3fv(program_id, location, count, value);
   }
   void uniform4fv(GLint location, GLsizei count, const GLfloat *value) {
-    Program prev = Program::getCurrentProgram();
-    useProgram();
-    glUniform4fv(location, count, value);
-    prev.useProgram();
+    glProgramUniform4fv(program_id, location, count, value);
   }
   void uniform1i(GLint location, const GLint value) {
-    Program prev = Program::getCurrentProgram();
-    useProgram();
-    glUniform1i(location, value);
-    prev.useProgram();
+    glProgramUniform1i(program_id, location, value);
   }
 };
+
+struct uniform_location {
+  std::uint32_t hash;
+  GLint location;
+};
 } // namespace impl
 
 class Program {
 public:
-  constexpr Program() : program(0) {}
-  constexpr Program(GLuint id) : program(id) {}
+  Program() : program{0} {}
+  Program(GLuint id) : program{id} { cacheUniforms(); }
   void use() { program.useProgram(); }
-  void delete_() { glDeleteProgram(program.program_id); }
-  void setUniform(const char *name, bool data) {
-    program.uniform1i(program.getUniformLocation(name),
-                      static_cast<GLint>(data ? GL_TRUE : GL_FALSE));
+  GLuint id() const { return program.program_id; }
+  void delete_() {
+    render_state::current().delete_program(program.program_id);
+    uniforms.clear();
   }
-  void setUniform(const char *name, GLint data) {
-    program.uniform1i(program.getUniformLocation(name), data);
+
+  // Location of a uniform resolved when the program was linked, -1 if the
+  // program has no such (active) uniform
+  GLint location(impl::uniform_name name) const {
+    return locationByHash(name.hash);
   }
-  void setUniform(const char *name, glm::mat3 const &data) {
-    program.uniformMatrix3fv(program.getUniformLocation(name), 1, GL_FALSE,
-                             glm::value_ptr(data));
+
+  void setUniform(GLint location, bool data) {
+    program.uniform1i(location, static_cast<GLint>(data ? GL_TRUE : GL_FALSE));
   }
-  void setUniform(const char *name, glm::mat4 const &data) {
-    program.uniformMatrix4fv(program.getUniformLocation(name), 1, GL_FALSE,
-                             glm::value_ptr(data));
+  void setUniform(GLint location, GLint data) {
+    program.uniform1i(location, data);
   }
-  void setUniform(const char *name, glm::vec3 const &data) {
-    program.uniform3fv(program.getUniformLocation(name), 1,
-                       glm::value_ptr(data));
+  void setUniform(GLint location, GLfloat data) {
+    program.uniform1f(location, data);
   }
-  void setUniform(const char *name, glm::vec4 const &data) {
-    program.uniform3fv(program.getUniformLocation(name), 1,
-                       glm::value_ptr(data));
+  void setUniform(GLint location, glm::mat3 const &data) {
+    program.uniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(data));
+  }
+  void setUniform(GLint location, glm::mat4 const &data) {
+    program.uniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(data));
+  }
+  void setUniform(GLint location, glm::vec2 const &data) {
+    program.uniform2fv(location, 1, glm::value_ptr(data));
+  }
+  void setUniform(GLint location, glm::vec3 const &data) {
+    program.uniform3fv(location, 1, glm::value_ptr(data));
+  }
+  void setUniform(GLint location, glm::vec4 const &data) {
+    program.uniform4fv(location, 1, glm::value_ptr(data));
+  }
+
+  template <typename T>
+  void setUniform(impl::uniform_name name, T const &data) {
+    setUniform(location(name), data);
   }
 
 private:
   impl::Program program;
+  std::vector<impl::uniform_location> uniforms;
+
+  void cacheUniforms() {
+    uniforms.clear();
+    if (program.program_id == 0) {
+      return;
+    }
+
+    GLint count = 0, max_length = 0;
+    glGetProgramiv(program.program_id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program.program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH,
+                   &max_length);
+
+    std::vector<char> name(max_length + 1);
+    for (GLint i = 0; i < count; i++) {
+      GLsizei length = 0;
+      GLint size = 0;
+      GLenum type = 0;
+      glGetActiveUniform(program.program_id, i, name.size(), &length, &size,
+                         &type, name.data());
+      std::string_view name_view{name.data(), static_cast<size_t>(length)};
+      // arrays are reported as "name[0]", index them by their base name
+      if (name_view.ends_with("[0]")) {
+        name_view.remove_suffix(3);
+      }
+
+      const std::uint32_t hash = impl::hash(name_view);
+      assert(locationByHash(hash) == -1 && "uniform name hash collision");
+      uniforms.push_back({hash, program.getUniformLocation(name.data())});
+    }
+  }
+
+  GLint locationByHash(std::uint32_t hash) const {
+    for (impl::uniform_location const &uniform : uniforms) {
+      if (uniform.hash == hash) {
+        return uniform.location;
+      }
+    }
+    return -1;
+  }
 };
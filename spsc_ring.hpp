@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+// Bounded lock-free single-producer/single-consumer queue.
+//
+// Exactly one thread may call try_push() and exactly one (other) thread may
+// call try_pop()/drain(). Neither side ever blocks or allocates; the producer
+// fails when the consumer has fallen a full ring behind.
+template <typename T, std::size_t Capacity> class spsc_ring {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+  static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+  bool try_push(T const &value) {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_cache_ == Capacity) {
+      // looks full, refresh our view of the consumer
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head - tail_cache_ == Capacity) {
+        return false;
+      }
+    }
+    slots_[head & MASK] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_pop(T &value) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_cache_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail == head_cache_) {
+        return false;
+      }
+    }
+    value = slots_[tail & MASK];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Hands every element pushed so far to `fn` in order, returns how many
+  template <typename F> std::size_t drain(F &&fn) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    head_cache_ = head_.load(std::memory_order_acquire);
+    for (std::size_t i = tail; i != head_cache_; i++) {
+      fn(slots_[i & MASK]);
+    }
+    tail_.store(head_cache_, std::memory_order_release);
+    return head_cache_ - tail;
+  }
+
+  static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+  static constexpr std::size_t MASK = Capacity - 1;
+  // keep the two sides from false sharing a cache line
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  alignas(CACHE_LINE) std::atomic<std::size_t> head_{0}; // written by producer
+  std::size_t tail_cache_{0};                            // producer's view
+  alignas(CACHE_LINE) std::atomic<std::size_t> tail_{0}; // written by consumer
+  std::size_t head_cache_{0};                            // consumer's view
+  alignas(CACHE_LINE) T slots_[Capacity];
+};
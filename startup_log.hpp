@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// Prints how long each stage of startup took to stderr:
+//
+//   startup: gl context                        35.12 ms  (35.12 ms total)
+//
+// Stages are timed from the end of the previous one, the first from begin(),
+// which main() calls before anything else. Only meant for the
+// single-threaded stretch before the first frame.
+class startup_log {
+public:
+  static void begin() { last() = first(); }
+  static void stage(const char *name) {
+    const clock::time_point now = clock::now();
+    std::fprintf(stderr, "startup: %-28s %8.2f ms  (%0.2f ms total)\n", name,
+                 ms(now - last()), ms(now - first()));
+    last() = now;
+  }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  static float ms(clock::duration d) {
+    return std::chrono::duration<float, std::milli>(d).count();
+  }
+  static clock::time_point first() {
+    static const clock::time_point start = clock::now();
+    return start;
+  }
+  static clock::time_point &last() {
+    static clock::time_point previous = first();
+    return previous;
+  }
+};
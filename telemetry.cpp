@@ -0,0 +1,52 @@
+#include "telemetry.hpp"
+
+#include <chrono>
+#include <cmath>
+
+#include "gauge_config.hpp"
+
+std::int64_t telemetry_now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+telemetry_sample simulated_sample(std::int64_t start_ns, std::int64_t now_ns,
+                                  float hours) {
+  const double t = (now_ns - start_ns) * 1e-9;
+  return {
+      now_ns,
+      map<float>(std::sin(t * 0.5), -1, 1, RPM_MIN, RPM_MAX),
+      hours + static_cast<float>(t / 3600.0),
+  };
+}
+
+void simulated_sensor::start(telemetry_ring &ring, float rate_hz, float hours,
+                             void (*wake)()) {
+  stop();
+  quit = false;
+  thread = std::thread([this, &ring, rate_hz, hours, wake] {
+    const auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(1.0 / rate_hz));
+    const std::int64_t start = telemetry_now();
+    auto next = std::chrono::steady_clock::now();
+    while (!quit.load(std::memory_order_relaxed)) {
+      const telemetry_sample sample =
+          simulated_sample(start, telemetry_now(), hours);
+      // a full ring means the consumer is behind, drop rather than block
+      if (ring.try_push(sample) && wake) {
+        wake();
+      }
+
+      next += period;
+      std::this_thread::sleep_until(next);
+    }
+  });
+}
+
+void simulated_sensor::stop() {
+  if (thread.joinable()) {
+    quit = true;
+    thread.join();
+  }
+}
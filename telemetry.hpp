@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "spsc_ring.hpp"
+
+// One reading from the engine
+struct telemetry_sample {
+  std::int64_t time_ns; // steady clock, see telemetry_now()
+  float rpm;
+  float hours;
+};
+
+using telemetry_ring = spsc_ring<telemetry_sample, 1024>;
+
+std::int64_t telemetry_now();
+
+// The rpm sweep simulated_sensor produces at `now_ns` for a run that began at
+// `start_ns`
+telemetry_sample simulated_sample(std::int64_t start_ns, std::int64_t now_ns,
+                                  float hours);
+
+// Stand-in for the real sensor: a producer thread sweeping the rpm up and down
+// and pushing a sample into the ring at a fixed rate.
+//
+// The ring has a single producer, so nothing else may push while this runs.
+// `wake`, when given, is called from the producer thread after every push so
+// a consumer sleeping until something happens (i.e. glfwPostEmptyEvent) can
+// be woken up.
+class simulated_sensor {
+public:
+  void start(telemetry_ring &ring, float rate_hz, float hours,
+             void (*wake)() = nullptr);
+  void stop();
+  bool running() const { return thread.joinable(); }
+
+  ~simulated_sensor() { stop(); }
+
+private:
+  std::thread thread;
+  std::atomic<bool> quit{false};
+};
@@ -0,0 +1,189 @@
+#include "telemetry_log.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+bool telemetry_recorder::open(const char *path) {
+  close();
+  file = std::fopen(path, "wb");
+  if (!file) {
+    std::perror(path);
+    return false;
+  }
+
+  // placeholder header, record_count = 0 marks the log as still being written
+  telemetry_log::header header{};
+  std::memcpy(header.magic, telemetry_log::MAGIC, sizeof(header.magic));
+  header.record_size = sizeof(telemetry_sample);
+  header.index_interval = telemetry_log::INDEX_INTERVAL;
+  if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+    std::perror(path);
+    std::fclose(file);
+    file = nullptr;
+    return false;
+  }
+  count = 0;
+  index.clear();
+  failed = false;
+  return true;
+}
+
+void telemetry_recorder::append(telemetry_sample const &sample) {
+  if (failed) {
+    return;
+  }
+  // a full disk stops the recording, close() still finalizes what made it
+  if (std::fwrite(&sample, sizeof(sample), 1, file) != 1) {
+    std::perror("telemetry log");
+    failed = true;
+    return;
+  }
+  if (count % telemetry_log::INDEX_INTERVAL == 0) {
+    index.push_back({sample.time_ns, count});
+  }
+  count++;
+}
+
+void telemetry_recorder::close() {
+  if (!file) {
+    return;
+  }
+
+  telemetry_log::header header{};
+  std::memcpy(header.magic, telemetry_log::MAGIC, sizeof(header.magic));
+  header.record_size = sizeof(telemetry_sample);
+  header.index_interval = telemetry_log::INDEX_INTERVAL;
+  header.record_count = count;
+  header.index_offset = sizeof(header) + count * sizeof(telemetry_sample);
+  header.index_count = index.size();
+  // after the last whole record, a short write may have left part of one
+  const bool index_written =
+      std::fseek(file, header.index_offset, SEEK_SET) == 0 &&
+      std::fwrite(index.data(), sizeof(telemetry_log::index_entry),
+                  index.size(), file) == index.size();
+  if (!index_written) {
+    header.index_count = 0; // seek() then searches every record
+  }
+
+  const bool ok = std::fseek(file, 0, SEEK_SET) == 0 &&
+                  std::fwrite(&header, sizeof(header), 1, file) == 1;
+  if (std::fclose(file) != 0 || !ok) {
+    std::perror("telemetry log");
+  }
+  file = nullptr;
+}
+
+bool telemetry_replay::open(const char *path) {
+  close();
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    std::perror(path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<std::size_t>(st.st_size) < sizeof(telemetry_log::header)) {
+    std::fprintf(stderr, "%s: not a telemetry log\n", path);
+    ::close(fd);
+    return false;
+  }
+  mapping_size = st.st_size;
+  mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    std::perror("mmap");
+    mapping = nullptr;
+    return false;
+  }
+
+  const auto *base = static_cast<const unsigned char *>(mapping);
+  const auto *header = reinterpret_cast<const telemetry_log::header *>(base);
+  if (std::memcmp(header->magic, telemetry_log::MAGIC, sizeof(header->magic)) ||
+      header->record_size != sizeof(telemetry_sample)) {
+    std::fprintf(stderr, "%s: not a telemetry log\n", path);
+    close();
+    return false;
+  }
+
+  const auto *first =
+      reinterpret_cast<const telemetry_sample *>(base + sizeof(*header));
+  // A log whose recorder never finished, or whose header does not add up,
+  // is replayed from every complete record there is. Every check below is
+  // written so that corrupt sizes cannot overflow it.
+  std::size_t count =
+      (mapping_size - sizeof(*header)) / sizeof(telemetry_sample);
+  const std::uint64_t index_offset = header->index_offset;
+  const bool closed =
+      index_offset >= sizeof(*header) && index_offset <= mapping_size &&
+      index_offset % alignof(telemetry_log::index_entry) == 0 &&
+      header->record_count <=
+          (index_offset - sizeof(*header)) / sizeof(telemetry_sample) &&
+      header->index_count <= (mapping_size - index_offset) /
+                                 sizeof(telemetry_log::index_entry);
+  if (closed) {
+    count = header->record_count;
+    index = {reinterpret_cast<const telemetry_log::index_entry *>(
+                 base + index_offset),
+             header->index_count};
+    index_interval = header->index_interval;
+    // seek() narrows its search to the records between two entries, they
+    // have to be in order and inside the log; search everything otherwise
+    std::uint64_t previous = 0;
+    for (telemetry_log::index_entry const &entry : index) {
+      if (entry.record >= count || entry.record < previous) {
+        index = {};
+        break;
+      }
+      previous = entry.record;
+    }
+  }
+  records = {first, count};
+  return true;
+}
+
+void telemetry_replay::close() {
+  if (mapping) {
+    munmap(mapping, mapping_size);
+    mapping = nullptr;
+  }
+  records = {};
+  index = {};
+}
+
+std::int64_t telemetry_replay::begin_ns() const {
+  return records.empty() ? 0 : records.front().time_ns;
+}
+
+std::int64_t telemetry_replay::end_ns() const {
+  return records.empty() ? 0 : records.back().time_ns;
+}
+
+std::size_t telemetry_replay::seek(std::int64_t time_ns) const {
+  // narrow down to one index interval first if there is an index
+  std::size_t lo = 0, hi = records.size();
+  if (!index.empty()) {
+    auto it = std::upper_bound(index.begin(), index.end(), time_ns,
+                               [](std::int64_t t, auto const &entry) {
+                                 return t < entry.time_ns;
+                               });
+    if (it != index.begin()) {
+      lo = std::prev(it)->record;
+    }
+    if (it != index.end()) {
+      hi = it->record;
+    }
+  }
+
+  auto first = records.begin() + lo;
+  auto it = std::upper_bound(first, records.begin() + hi, time_ns,
+                             [](std::int64_t t, telemetry_sample const &s) {
+                               return t < s.time_ns;
+                             });
+  return it == records.begin() ? 0 : (it - records.begin()) - 1;
+}
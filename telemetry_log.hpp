@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+#include "telemetry.hpp"
+
+// Binary telemetry log, native endianness:
+//
+//   header | telemetry_sample * record_count | index_entry * index_count
+//
+// Records are fixed size and in time order. Every INDEX_INTERVAL records the
+// recorder notes the record's timestamp; the index is appended when the log
+// is closed, so seeking is a binary search over the index followed by one over
+// at most INDEX_INTERVAL records. A log whose recorder died before close()
+// has no index and is searched over the records directly.
+namespace telemetry_log {
+static constexpr char MAGIC[8] = {'R', 'P', 'M', 'L', 'O', 'G', 0, 1};
+static constexpr std::uint32_t INDEX_INTERVAL = 1024;
+
+struct header {
+  char magic[8];
+  std::uint32_t record_size;
+  std::uint32_t index_interval;
+  std::uint64_t record_count; // 0 until closed, then derive from file size
+  std::uint64_t index_offset; // 0 if there is no index
+  std::uint64_t index_count;
+  std::uint64_t reserved[3];
+};
+static_assert(sizeof(header) == 64);
+
+struct index_entry {
+  std::int64_t time_ns;
+  std::uint64_t record;
+};
+} // namespace telemetry_log
+
+class telemetry_recorder {
+public:
+  bool open(const char *path);
+  void append(telemetry_sample const &sample);
+  // Writes the index and final header. A log that was never closed still
+  // replays, without an index, as far as its last whole record.
+  void close();
+
+  bool is_open() const { return file != nullptr; }
+
+  ~telemetry_recorder() { close(); }
+
+private:
+  std::FILE *file{nullptr};
+  std::uint64_t count{0}; // records written in full
+  bool failed{false};     // a write failed, nothing more is appended
+  std::vector<telemetry_log::index_entry> index;
+};
+
+// Read only view of a log, mapped straight from disk without copying
+class telemetry_replay {
+public:
+  bool open(const char *path);
+  void close();
+
+  bool is_open() const { return mapping != nullptr; }
+  std::span<const telemetry_sample> samples() const { return records; }
+  std::int64_t begin_ns() const;
+  std::int64_t end_ns() const;
+
+  // Position of the newest sample at or before `time_ns` (0 if there is
+  // none), in O(log n)
+  std::size_t seek(std::int64_t time_ns) const;
+
+  ~telemetry_replay() { close(); }
+
+private:
+  void *mapping{nullptr};
+  std::size_t mapping_size{0};
+  std::span<const telemetry_sample> records;
+  std::span<const telemetry_log::index_entry> index;
+  std::uint32_t index_interval{telemetry_log::INDEX_INTERVAL};
+};
@@ -0,0 +1,99 @@
+#include "telemetry_shm.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <new>
+
+bool telemetry_shm::create(const char *name) {
+  close();
+  const int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    std::perror("shm_open");
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    std::perror("fstat");
+    ::close(fd);
+    return false;
+  }
+  const bool sized = static_cast<std::size_t>(st.st_size) == sizeof(layout);
+  if (!sized && ftruncate(fd, sizeof(layout)) != 0) {
+    std::perror("ftruncate");
+    ::close(fd);
+    return false;
+  }
+  void *mem =
+      mmap(nullptr, sizeof(layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mem == MAP_FAILED) {
+    std::perror("mmap");
+    return false;
+  }
+
+  // A restarted writer keeps the sequence of the segment it left behind,
+  // resetting it would confuse readers that are still mapped
+  segment = static_cast<layout *>(mem);
+  if (!sized || segment->magic != MAGIC || segment->size != sizeof(layout)) {
+    segment = new (mem) layout{MAGIC, sizeof(layout), {}};
+  }
+  return true;
+}
+
+bool telemetry_shm::open(const char *name) {
+  close();
+  const int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    std::perror("shm_open");
+    return false;
+  }
+  // the writer sizes the segment just after creating it, mapping it before
+  // then and reading the header would raise SIGBUS
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<std::size_t>(st.st_size) < sizeof(layout)) {
+    std::fprintf(stderr, "telemetry_shm: %s is not ready yet\n", name);
+    ::close(fd);
+    return false;
+  }
+  void *mem = mmap(nullptr, sizeof(layout), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mem == MAP_FAILED) {
+    std::perror("mmap");
+    return false;
+  }
+
+  segment = static_cast<layout *>(mem);
+  if (segment->magic != MAGIC || segment->size != sizeof(layout)) {
+    std::fprintf(stderr, "telemetry_shm: %s has an unexpected layout\n", name);
+    close();
+    return false;
+  }
+  last_version = 0;
+  return true;
+}
+
+void telemetry_shm::close() {
+  if (segment) {
+    munmap(segment, sizeof(layout));
+    segment = nullptr;
+  }
+}
+
+void telemetry_shm::publish(telemetry_sample const &sample) {
+  segment->latest.store(sample);
+}
+
+bool telemetry_shm::poll(telemetry_sample &sample) {
+  const std::uint32_t version = segment->latest.version();
+  if (version == last_version || !segment->latest.load(sample)) {
+    return false;
+  }
+  last_version = version;
+  return true;
+}
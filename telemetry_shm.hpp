@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+#include "seqlock.hpp"
+#include "telemetry.hpp"
+
+// POSIX shared memory segment through which an external data acquisition
+// process publishes the latest telemetry_sample to the gauge.
+//
+// There is a single writer (create()) and any number of readers (open()).
+// Readers never block the writer, see seqlock.
+class telemetry_shm {
+public:
+  static constexpr char DEFAULT_NAME[] = "/rpm_gauge";
+
+  // writer side, creates the segment or reuses one with the same layout
+  // as it is
+  bool create(const char *name);
+  // reader side, maps an existing segment read only, false if its writer
+  // has not finished setting it up
+  bool open(const char *name);
+  void close();
+
+  void publish(telemetry_sample const &sample);
+  // Copies the newest sample into `sample` if one was published since the
+  // previous call that returned true
+  bool poll(telemetry_sample &sample);
+
+  bool is_open() const { return segment != nullptr; }
+
+  ~telemetry_shm() { close(); }
+
+private:
+  struct layout {
+    std::uint32_t magic;
+    std::uint32_t size;
+    seqlock<telemetry_sample> latest;
+  };
+  static constexpr std::uint32_t MAGIC = 0x52504d47; // "RPMG"
+
+  layout *segment{nullptr};
+  std::uint32_t last_version{0};
+};
@@ -0,0 +1,59 @@
+// Stand-in for the data acquisition process: publishes a simulated rpm sweep
+// into the gauge's shared memory segment.
+//
+//   telemetry_writer [--name /rpm_gauge] [--rate HZ] [--hours H]
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <thread>
+
+#include "telemetry.hpp"
+#include "telemetry_shm.hpp"
+
+static volatile std::sig_atomic_t quit = 0;
+
+int main(int argc, char **argv) {
+  const char *name = telemetry_shm::DEFAULT_NAME;
+  double rate_hz = 10000;
+  float hours = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg == "--name" && i + 1 < argc) {
+      name = argv[++i];
+    } else if (arg == "--rate" && i + 1 < argc) {
+      rate_hz = std::atof(argv[++i]);
+    } else if (arg == "--hours" && i + 1 < argc) {
+      hours = std::atof(argv[++i]);
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--name NAME] [--rate HZ] [--hours H]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  telemetry_shm shm;
+  if (!shm.create(name)) {
+    return 1;
+  }
+  std::signal(SIGINT, [](int) { quit = 1; });
+  std::signal(SIGTERM, [](int) { quit = 1; });
+  std::printf("publishing to %s at %0.0f Hz, ^C to stop\n", name, rate_hz);
+
+  const auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(1.0 / rate_hz));
+  const std::int64_t start = telemetry_now();
+  auto next = std::chrono::steady_clock::now();
+  long long published = 0;
+  while (!quit) {
+    shm.publish(simulated_sample(start, telemetry_now(), hours));
+    published++;
+    next += period;
+    std::this_thread::sleep_until(next);
+  }
+
+  std::printf("published %lld samples\n", published);
+  return 0;
+}
@@ -1,14 +1,15 @@
 #include "text_renderer.hpp"
-
-#include <ft2build.h>
-#include FT_FREETYPE_H
+#include "program_cache.hpp"
+#include "render_state.hpp"
+#include "startup_log.hpp"
+#include "utf8.hpp"
 
 #include <glm/glm.hpp>
 
-#if __APPLE__
-static const char FONT_PATH[] =
-    "/System/Library/Fonts/Supplemental/Arial Bold.ttf";
-#endif
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
 
 static constexpr bool DEBUG_DISABLE_BLENDING = false;
 
@@ -21,17 +22,17 @@ static constexpr glm::vec2 verts[] = {
 
 static const char *vert = R"GLSL(#version 410 core
 layout(location=0) in vec2 position;
+layout(location=1) in vec4 rect;    // per glyph: xy = origin, zw = size
+layout(location=2) in vec4 uv_rect; // xy = top left, zw = bottom right
 
-uniform mat4 transform;
 uniform mat4 projection;
 
 out vec2 TexCoords;
 
 void main()
 {
-  gl_Position = projection * transform * vec4(position.xy, 0.0, 1.0);
-  TexCoords = position.xy;
-  TexCoords.y = 1.0f - TexCoords.y;
+  gl_Position = projection * vec4(rect.xy + position.xy * rect.zw, 0.0, 1.0);
+  TexCoords = mix(uv_rect.xy, uv_rect.zw, vec2(position.x, 1.0f - position.y));
 }
 )GLSL";
 
@@ -48,59 +49,95 @@ void main()
 }
 )GLSL";
 
-void text_renderer::allocate() {
-  glGenVertexArrays(1, &vao);
-  glGenBuffers(1, &vbo);
-
-  glBindVertexArray(vao);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
-
-  GLint success = 0;
+// Distance fields resample cleanly, coverage is thresholded at the outline
+// and antialiased over about one pixel on screen, whatever the scale
+static const char *sdf_frag = R"GLSL(#version 410 core
+in vec2 TexCoords;
+out vec4 outColor;
 
-  GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vert_shader, 1, &vert, NULL);
-  glCompileShader(vert_shader);
-  glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &success);
-  assert(success);
+uniform vec3 color;
+uniform sampler2D text;
 
-  GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(frag_shader, 1, &frag, NULL);
-  glCompileShader(frag_shader);
-  glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &success);
-  assert(success);
+const float EDGE = 128.0 / 255.0;
 
-  GLuint program_id = glCreateProgram();
+void main()
+{
+  float distance = texture(text, TexCoords).r;
+  float width = 0.5 * fwidth(distance);
+  outColor = vec4(color, smoothstep(EDGE - width, EDGE + width, distance));
+}
+)GLSL";
 
-  glAttachShader(program_id, vert_shader);
-  glAttachShader(program_id, frag_shader);
-  glLinkProgram(program_id);
-  glDetachShader(program_id, vert_shader);
-  glDetachShader(program_id, frag_shader);
+void text_renderer::allocate(glyph_format glyphs,
+                             std::function<void()> on_loaded) {
+  render_state &state = render_state::current();
 
-  glDeleteShader(vert_shader);
-  glDeleteShader(frag_shader);
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vbo);
+  glGenBuffers(1, &instance_vbo);
 
-  glGetProgramiv(program_id, GL_LINK_STATUS, (int *)&success);
-  assert(success);
+  state.bind_vertex_array(vao);
+  state.bind_array_buffer(vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
 
-  program = program_id;
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
 
-  load_characters();
+  // one impl::glyph_instance per quad, refilled on every flush()
+  state.bind_array_buffer(instance_vbo);
+  glEnableVertexAttribArray(1);
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(impl::glyph_instance),
+                        (void *)offsetof(impl::glyph_instance, rect));
+  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(impl::glyph_instance),
+                        (void *)offsetof(impl::glyph_instance, uv_rect));
+  glVertexAttribDivisor(1, 1);
+  glVertexAttribDivisor(2, 1);
+  state.bind_array_buffer(0);
+  state.bind_vertex_array(0);
+
+  format = glyphs;
+  pixel_size = format == glyph_format::sdf ? SDF_PIXEL_SIZE : FONT_PIXEL_SIZE;
+  program = program_cache::current().load(
+      vert, format == glyph_format::sdf ? sdf_frag : frag);
+
+  ascii = {};
+  unicode.clear();
+  window_size = {0, 0};
+  loaded = false;
+  uploaded = false;
+  loader = std::thread([this, on_loaded = std::move(on_loaded)] {
+    load_characters();
+    loaded.store(true, std::memory_order_release);
+    loaded.notify_all();
+    if (on_loaded) {
+      on_loaded();
+    }
+  });
 }
 
 void text_renderer::destroy() {
+  if (loader.joinable()) {
+    loader.join();
+  }
+  mapped.close();
+  rasterized = {};
+  rasterizer.close();
   program.delete_();
-  glDeleteVertexArrays(1, &vao);
-  glDeleteBuffers(1, &vbo);
+  render_state &state = render_state::current();
+  if (uploaded) {
+    state.delete_texture(atlas);
+  }
+  state.delete_vertex_array(vao);
+  state.delete_buffer(vbo);
+  state.delete_buffer(instance_vbo);
 }
 
 void text_renderer::set_window_size(int width, int height) {
+  if (window_size == glm::ivec2{width, height}) {
+    return;
+  }
+  window_size = {width, height};
   glm::mat4 projection = glm::ortho<float>(0, width, 0, height);
   program.setUniform("projection", projection);
 }
@@ -110,109 +147,255 @@ void text_renderer::set_color(glm::vec3 color) {
 }
 
 void text_renderer::draw(std::string_view text, float x, float y, float scale) {
-  GLint last_blend;
-  GLint last_blend_src_alpha;
-  GLint last_program;
-  GLint last_texture_2D;
-  GLint last_vertex_array;
-  glGetIntegerv(GL_BLEND, &last_blend);
-  glGetIntegerv(GL_BLEND_SRC_ALPHA, &last_blend_src_alpha);
-  glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture_2D);
-  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &last_vertex_array);
+  queue(text, x, y, scale);
+  flush();
+}
 
-  if constexpr (!DEBUG_DISABLE_BLENDING) {
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+void text_renderer::queue(std::string_view text, float x, float y,
+                          float scale) {
+  if (!uploaded) {
+    return;
   }
+  auto start = std::chrono::steady_clock::now();
+  lay_out(text, x, y, scale, pending, nullptr);
+  frame_stats.cpu_time += std::chrono::steady_clock::now() - start;
+}
 
-  // activate corresponding render state
-  program.use();
-  glBindVertexArray(vao);
+void text_renderer::queue(text_layout &layout) {
+  if (!uploaded) {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (layout.dirty || layout.generation != generation) {
+    layout.quads.clear();
+    layout.pages.clear();
+    lay_out(layout.str, layout.x, layout.y, layout.scale, layout.quads,
+            &layout.pages);
+    layout.dirty = false;
+    layout.generation = generation;
+    frame_stats.layouts++;
+  } else {
+    // the quads point into these, keep them from being recycled this batch
+    for (int page : layout.pages) {
+      pages.touch(page, batch);
+    }
+  }
+  pending.insert(pending.end(), layout.quads.begin(), layout.quads.end());
+  frame_stats.cpu_time += std::chrono::steady_clock::now() - start;
+}
 
-  // iterate through all characters
-  for (char c : text) {
-    const impl::character_details &details = ch[c];
+void text_renderer::lay_out(std::string_view text, float x, float y,
+                            float scale,
+                            std::vector<impl::glyph_instance> &out,
+                            std::vector<int> *used_pages) {
+  // metrics are in atlas texels, callers scale from FONT_PIXEL_SIZE
+  scale *= float(FONT_PIXEL_SIZE) / float(pixel_size);
 
-    if (c == ' ') {
-      x += (details.Advance >> 6) * scale;
+  // iterate through all characters
+  for (std::size_t i = 0; i < text.size();) {
+    const char32_t c = decodeUtf8(text, i);
+    const impl::character_details *glyph = nullptr;
+    if (c < ascii.size()) {
+      glyph = &ascii[c];
+    } else if (const unicode_glyph *found = find_glyph(c)) {
+      glyph = &found->details;
+      if (used_pages) {
+        used_pages->push_back(found->page);
+      }
     } else {
+      continue; // no room in the atlas this batch
+    }
+    const impl::character_details &details = *glyph;
+
+    if (c != ' ') {
       float xpos = x + details.Bearing.x * scale;
       float ypos = y - (details.Size.y - details.Bearing.y) * scale;
 
-      glm::mat4 transform =
-          glm::translate(glm::mat4{1.0f}, glm::vec3{xpos, ypos, 0}) *
-          glm::scale(glm::mat4{1.0f}, glm::vec3{details.Size.x * scale,
-                                                details.Size.y * scale, 1});
-      // render quad
-      program.setUniform("transform", transform);
-
-      // render glyph texture over quad
-      // glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, 1);
-      glBindTexture(GL_TEXTURE_2D, details.TextureID);
-      glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-      // now advance cursors for next glyph (note that advance is number of 1/64
-      // pixels)
-      // bitshift by 6 to get value in pixels (2^6 = 64)
-      x += (details.Advance >> 6) * scale;
+      out.push_back({glm::vec4{xpos, ypos, glm::vec2{details.Size} * scale},
+                     glm::vec4{details.UvMin, details.UvMax}});
     }
+
+    // now advance cursors for next glyph (note that advance is number of 1/64
+    // pixels)
+    // bitshift by 6 to get value in pixels (2^6 = 64)
+    x += (details.Advance >> 6) * scale;
   }
-  glBindVertexArray(last_vertex_array);
-  glBindTexture(GL_TEXTURE_2D, last_texture_2D);
-  glUseProgram(last_program);
-  glBlendFunc(GL_SRC_ALPHA, last_blend_src_alpha);
-  last_blend ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
 }
 
-void text_renderer::load_characters() {
-  GLint last_unpack_alignment;
-  GLint last_texture_2D;
-  glGetIntegerv(GL_UNPACK_ALIGNMENT, &last_unpack_alignment);
-  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture_2D);
+void text_renderer::flush() {
+  if (pending.empty()) {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  render_state &state = render_state::current();
 
-  FT_Library ft;
-  if (FT_Init_FreeType(&ft)) {
-    exit(1);
+  // callers set up their own state, nothing needs restoring afterwards
+  if constexpr (!DEBUG_DISABLE_BLENDING) {
+    state.set_blend(true);
+    state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   }
-  FT_Face face;
-  if (FT_New_Face(ft, FONT_PATH, 0, &face)) {
+
+  // activate corresponding render state
+  program.use();
+  state.bind_vertex_array(vao);
+  state.bind_texture_2d(atlas);
+
+  // orphan the previous contents so the driver never stalls on them
+  state.bind_array_buffer(instance_vbo);
+  glBufferData(GL_ARRAY_BUFFER,
+               pending.size() * sizeof(impl::glyph_instance), pending.data(),
+               GL_STREAM_DRAW);
+
+  // every queued glyph in one draw call
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                        static_cast<GLsizei>(pending.size()));
+  frame_stats.draw_calls++;
+  frame_stats.glyphs += pending.size();
+  clear();
+
+  frame_stats.cpu_time += std::chrono::steady_clock::now() - start;
+}
+
+void text_layout::set(std::string_view text, float at_x, float at_y,
+                      float at_scale) {
+  if (text == str && at_x == x && at_y == y && at_scale == scale) {
+    return;
+  }
+  str.assign(text);
+  x = at_x;
+  y = at_y;
+  scale = at_scale;
+  dirty = true;
+}
+
+text_renderer::stats text_renderer::reset_stats() {
+  stats ret = frame_stats;
+  frame_stats = {};
+  return ret;
+}
+
+bool text_renderer::poll_loaded() {
+  if (uploaded || !loaded.load(std::memory_order_acquire)) {
+    return uploaded;
+  }
+  loader.join();
+  if (load_failed) {
     exit(1);
   }
-  FT_Set_Pixel_Sizes(face, 0, 48);
+  if (mapped.is_open()) {
+    upload_atlas(mapped.size(), mapped.pixels(), mapped.glyphs());
+    mapped.close();
+  } else {
+    upload_atlas(rasterized.size, rasterized.pixels.data(), rasterized.glyphs);
+    rasterized = {};
+  }
+  uploaded = true;
+  generation++;
+  startup_log::stage("glyph atlas");
+  return true;
+}
 
-  GLuint textures[127];
-  glGenTextures(127, textures);
+void text_renderer::finish_loading() {
+  loaded.wait(false, std::memory_order_acquire);
+  poll_loaded();
+}
 
+// Runs on the loader thread, no GL in here
+void text_renderer::load_characters() {
+  glyph_cache &cache = glyph_cache::current();
+  if (cache.find(FONT_PATH, pixel_size, format, mapped)) {
+    return;
+  }
+  load_failed = !rasterizeAtlas(FONT_PATH, pixel_size, format, rasterized);
+  if (!load_failed) {
+    cache.store(FONT_PATH, pixel_size, format, rasterized);
+  }
+}
+
+void text_renderer::upload_atlas(int size, const unsigned char *pixels,
+                                 std::span<const glyph_atlas::glyph> glyphs) {
+  // the preloaded glyphs sit in the top left corner, pinned
+  const int atlas_size = std::max(ATLAS_SIZE, 2 * size);
+  pages.reset(atlas_size, PAGE_SIZE);
+  pages.pin(size);
+  blank_page.assign(PAGE_SIZE * PAGE_SIZE, 0);
+  const float to_atlas = float(size) / float(atlas_size);
+  for (const glyph_atlas::glyph &glyph : glyphs) {
+    impl::character_details &details =
+        ascii[static_cast<unsigned char>(glyph.c) % ascii.size()];
+    details = glyph.details;
+    details.UvMin *= to_atlas;
+    details.UvMax *= to_atlas;
+  }
+
+  render_state &state = render_state::current();
+  glGenTextures(1, &atlas);
+  state.bind_texture_2d(atlas);
   // disable byte-alignment restriction
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  for (unsigned char c = 0; c < 128; c++) {
-    // load character glyph
-    if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-      continue;
-    }
-    // generate texture
-    glBindTexture(GL_TEXTURE_2D, textures[c]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, face->glyph->bitmap.width,
-                 face->glyph->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE,
-                 face->glyph->bitmap.buffer);
-    // set texture options
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // now store character for later use
-    impl::character_details character = {
-        textures[c],
-        glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-        glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-        static_cast<unsigned int>(face->glyph->advance.x)};
-    ch.insert(std::pair<char, impl::character_details>(c, character));
-  }
-  FT_Done_Face(face);
-  FT_Done_FreeType(ft);
-
-  glBindTexture(GL_TEXTURE_2D, last_texture_2D);
-  glPixelStorei(GL_UNPACK_ALIGNMENT, last_unpack_alignment);
-}
\ No newline at end of file
+  state.set_unpack_alignment(1);
+  // unused pages are cleared as they are taken into use
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlas_size, atlas_size, 0, GL_RED,
+               GL_UNSIGNED_BYTE, nullptr);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RED,
+                  GL_UNSIGNED_BYTE, pixels);
+  // set texture options
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+const text_renderer::unicode_glyph *
+text_renderer::find_glyph(char32_t codepoint) {
+  const auto it = unicode.find(codepoint);
+  if (it == unicode.end()) {
+    return load_glyph(codepoint);
+  }
+  pages.touch(it->second.page, batch);
+  return &it->second;
+}
+
+const text_renderer::unicode_glyph *
+text_renderer::load_glyph(char32_t codepoint) {
+  if (!rasterizer.is_open() &&
+      !rasterizer.open(FONT_PATH, pixel_size, format)) {
+    return nullptr;
+  }
+  if (!rasterizer.render(codepoint, scratch)) {
+    return nullptr;
+  }
+
+  // padded like the preloaded atlas, see rasterizeAtlas()
+  const glm::ivec2 size = scratch.details.Size;
+  glyph_pages::placement at;
+  evicted.clear();
+  if (!pages.place(codepoint, size + 1, batch, at, evicted)) {
+    return nullptr;
+  }
+  for (char32_t old : evicted) {
+    unicode.erase(old);
+  }
+  if (!evicted.empty()) {
+    generation++;
+  }
+
+  render_state &state = render_state::current();
+  state.bind_texture_2d(atlas);
+  state.set_unpack_alignment(1);
+  if (at.fresh) {
+    const glm::ivec2 page = at.origin / PAGE_SIZE * PAGE_SIZE;
+    glTexSubImage2D(GL_TEXTURE_2D, 0, page.x, page.y, PAGE_SIZE, PAGE_SIZE,
+                    GL_RED, GL_UNSIGNED_BYTE, blank_page.data());
+  }
+  if (size.x > 0 && size.y > 0) {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, at.origin.x, at.origin.y, size.x,
+                    size.y, GL_RED, GL_UNSIGNED_BYTE, scratch.pixels.data());
+  }
+
+  impl::character_details details = scratch.details;
+  const float atlas_size = float(pages.atlas_size());
+  details.UvMin = glm::vec2(at.origin) / atlas_size;
+  details.UvMax = glm::vec2(at.origin + size) / atlas_size;
+  return &unicode.emplace(codepoint, unicode_glyph{details, at.page})
+              .first->second;
+}
@@ -1,34 +1,161 @@
 #pragma once
 
+#include "glyph_atlas.hpp"
 #include "shader.hpp"
 #include <glad/gl.h>
 #include <glm/glm.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace impl {
-struct character_details {
-  GLuint TextureID;     // ID handle of the glyph texture
-  glm::ivec2 Size;      // Size of glyph
-  glm::ivec2 Bearing;   // Offset from baseline to left/top of glyph
-  unsigned int Advance; // Offset to advance to next glyph
+struct glyph_instance {
+  glm::vec4 rect;    // Screen space origin and size of the quad
+  glm::vec4 uv_rect; // Atlas region, see character_details
 };
 
 } // namespace impl
 
+// A label laid out once: its glyph quads are kept and re-queued as they are
+// until the string, position or scale change, or the glyphs they point to
+// move in the atlas. Once its buffers are big enough queuing it does not
+// allocate.
+class text_layout {
+public:
+  // Cheap when nothing changed, a changed label is laid out again by the
+  // next text_renderer::queue()
+  void set(std::string_view text, float x, float y, float scale);
+  // Makes room for labels of up to `bytes` bytes, so a label that grows
+  // (i.e. a counter gaining a digit) does not allocate then
+  void reserve(std::size_t bytes) {
+    str.reserve(bytes);
+    quads.reserve(bytes);
+  }
+
+private:
+  friend class text_renderer;
+  std::string str;
+  float x{0}, y{0}, scale{0};
+  bool dirty{true};
+  std::uint64_t generation{0}; // text_renderer::generation it was laid out at
+  std::vector<impl::glyph_instance> quads;
+  std::vector<int> pages; // atlas pages of glyphs outside ASCII
+};
+
 class text_renderer {
 public:
-  void allocate();
+  struct stats {
+    std::size_t draw_calls{0};
+    std::size_t glyphs{0};
+    std::size_t layouts{0}; // text_layouts that had to be laid out again
+    std::chrono::nanoseconds cpu_time{0};
+  };
+
+#if __APPLE__
+  static constexpr const char *FONT_PATH =
+      "/System/Library/Fonts/Supplemental/Arial Bold.ttf";
+#else
+  static constexpr const char *FONT_PATH =
+      "/usr/share/fonts/truetype/dejavu/DejaVuSans-Bold.ttf";
+#endif
+  // queue() scales are relative to this size in either format
+  static constexpr int FONT_PIXEL_SIZE = 48;
+  // distance fields are rasterized smaller, they scale up without blurring
+  static constexpr int SDF_PIXEL_SIZE = 32;
+  // The atlas texture never grows past this (or twice the preloaded ASCII
+  // atlas, if that is bigger), other glyphs share PAGE_SIZE square pages
+  static constexpr int ATLAS_SIZE = 1024;
+  static constexpr int PAGE_SIZE = 128;
+
+  // The glyph atlas is loaded (from the disk cache or FreeType) on a worker
+  // thread, until it is uploaded queue() drops every label. `on_loaded` runs
+  // on that worker once it is done, i.e. to wake up the thread that owns GL.
+  //
+  // With glyph_format::sdf one distance field atlas serves every scale,
+  // coverage glyphs blur when scaled up and alias when scaled down.
+  void allocate(glyph_format glyphs = glyph_format::coverage,
+                std::function<void()> on_loaded = {});
   void destroy();
 
+  // GL thread: uploads the atlas once the worker has it, true when the
+  // labels can be drawn
+  bool poll_loaded();
+  // GL thread: blocks until the atlas is uploaded
+  void finish_loading();
+
   void set_window_size(int width, int height);
   void set_color(glm::vec3 color);
+  // queue + flush, for one-off labels
   void draw(std::string_view text, float x, float y, float scale);
+  // lay out a UTF-8 label into the pending batch, GL is only touched to
+  // upload glyphs outside ASCII the first time they are used
+  void queue(std::string_view text, float x, float y, float scale);
+  // queue a cached label, laying it out first only if it changed
+  void queue(text_layout &layout);
+  // submit everything queued so far with a single instanced draw call
+  void flush();
+  // drop everything queued since the last flush
+  void clear() {
+    pending.clear();
+    batch++;
+  }
+  // counters accumulated since the previous call
+  stats reset_stats();
+  // glyphs outside ASCII currently in the atlas, never more than capacity
+  std::size_t cached_glyphs() const { return unicode.size(); }
+  std::size_t glyph_capacity() const { return pages.capacity(); }
 
 private:
-  GLuint vao, vbo;
+  GLuint vao, vbo, instance_vbo;
+  GLuint atlas; // ID handle of the glyph atlas texture
   Program program;
-  std::unordered_map<char, impl::character_details> ch;
+  glyph_format format{glyph_format::coverage};
+  int pixel_size{FONT_PIXEL_SIZE}; // of the atlas
+  glm::ivec2 window_size{0, 0};
+  std::vector<impl::glyph_instance> pending;
+  stats frame_stats;
+
+  // ASCII is preloaded and looked up directly, everything else is rendered
+  // into a page of the atlas on first use and dropped when it is recycled
+  struct unicode_glyph {
+    impl::character_details details;
+    int page;
+  };
+  std::array<impl::character_details, 128> ascii{};
+  std::unordered_map<char32_t, unicode_glyph> unicode;
+  glyph_pages pages;
+  glyph_rasterizer rasterizer; // opened on the first miss
+  glyph_rasterizer::bitmap scratch;
+  std::vector<char32_t> evicted;
+  std::vector<unsigned char> blank_page;
+  // bumped on every flush, pages used by the current batch stay put
+  std::uint64_t batch{1};
+  // bumped whenever glyphs move in the atlas, invalidating every text_layout
+  std::uint64_t generation{1};
+
+  // written by the loader, read on the GL thread once `loaded` is set
+  std::thread loader;
+  std::atomic<bool> loaded{false};
+  bool load_failed{false};
+  glyph_cache::view mapped;
+  glyph_atlas rasterized;
+  bool uploaded{false};
 
   void load_characters();
+  void upload_atlas(int size, const unsigned char *pixels,
+                    std::span<const glyph_atlas::glyph> glyphs);
+  const unicode_glyph *find_glyph(char32_t codepoint);
+  const unicode_glyph *load_glyph(char32_t codepoint);
+  void lay_out(std::string_view text, float x, float y, float scale,
+               std::vector<impl::glyph_instance> &out,
+               std::vector<int> *used_pages);
 };
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free single-writer/single-reader handoff of the latest value.
+//
+// The writer fills back() and publish()es it; the reader update()s to the
+// newest published value and reads it through front(). Each side owns one of
+// the three slots at any time and the third sits in the middle, so neither
+// side ever waits on or sees a slot the other is using. Values the reader
+// never picked up are overwritten, like spsc_ring this never blocks, but it
+// does not keep every value either.
+//
+// Unlike seqlock the slots are handed over rather than copied, so T can own
+// memory (and keep it from one use of a slot to the next).
+template <typename T> class triple_buffer {
+public:
+  // writer side
+  T &back() { return slots_[back_]; }
+  void publish() {
+    back_ = middle_.exchange(back_ | DIRTY, std::memory_order_acq_rel) & INDEX;
+  }
+
+  // reader side, true if a newer value was published since the last call
+  bool update() {
+    if ((middle_.load(std::memory_order_relaxed) & DIRTY) == 0) {
+      return false;
+    }
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+  T &front() { return slots_[front_]; }
+
+private:
+  static constexpr unsigned INDEX = 3;
+  static constexpr unsigned DIRTY = 4;
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  std::array<T, 3> slots_;
+  alignas(CACHE_LINE) unsigned back_{0};  // writer's slot
+  alignas(CACHE_LINE) unsigned front_{1}; // reader's slot
+  alignas(CACHE_LINE) std::atomic<unsigned> middle_{2};
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Decodes the code point starting at `text[i]` and advances `i` past it.
+// Malformed, overlong or truncated sequences and surrogates decode to U+FFFD
+// and consume a single byte, so the caller always makes progress.
+constexpr char32_t decodeUtf8(std::string_view text, std::size_t &i) {
+  constexpr char32_t REPLACEMENT = 0xfffd;
+  const auto byte = [&](std::size_t at) {
+    return static_cast<unsigned char>(text[at]);
+  };
+
+  const unsigned char lead = byte(i);
+  if (lead < 0x80) {
+    i++;
+    return lead;
+  }
+
+  int length = 0;
+  char32_t cp = 0, min = 0;
+  if ((lead & 0xe0) == 0xc0) {
+    length = 2, cp = lead & 0x1f, min = 0x80;
+  } else if ((lead & 0xf0) == 0xe0) {
+    length = 3, cp = lead & 0x0f, min = 0x800;
+  } else if ((lead & 0xf8) == 0xf0) {
+    length = 4, cp = lead & 0x07, min = 0x10000;
+  } else {
+    i++;
+    return REPLACEMENT;
+  }
+  if (i + length > text.size()) {
+    i++;
+    return REPLACEMENT;
+  }
+  for (int k = 1; k < length; k++) {
+    if ((byte(i + k) & 0xc0) != 0x80) {
+      i++;
+      return REPLACEMENT;
+    }
+    cp = (cp << 6) | (byte(i + k) & 0x3f);
+  }
+  if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) {
+    i++;
+    return REPLACEMENT;
+  }
+  i += length;
+  return cp;
+}